@@ -0,0 +1,27 @@
+# report the code size of the call sites, and the template instances they carry
+# usage: cmake -DNM=<nm> -DSIZE=<size> -DOBJECTS="<name>=<optimized object>=<unoptimized object>|..." -P report.cmake
+string(REPLACE "|" ";" OBJECTS "${OBJECTS}")
+foreach (entry IN LISTS OBJECTS)
+	string(REPLACE "=" ";" fields "${entry}")
+	list(GET fields 0 name)
+	list(GET fields 1 optimized)
+	list(GET fields 2 unoptimized)
+
+	file(SIZE "${optimized}" object_size)
+	set(text_size "?")
+	if (SIZE)
+		execute_process(COMMAND "${SIZE}" "${optimized}" OUTPUT_VARIABLE size_output)
+		string(REGEX MATCH "\n *([0-9]+)" _ "${size_output}")
+		set(text_size "${CMAKE_MATCH_1}")
+	endif ()
+
+	# every function template instantiated is emitted as a weak symbol
+	set(instances "?")
+	if (NM)
+		execute_process(COMMAND "${NM}" -C --defined-only "${unoptimized}" OUTPUT_VARIABLE symbols)
+		string(REGEX MATCHALL "[^\n]*lava::format::legacy::[^\n]*<[^\n]*" templates "${symbols}")
+		list(LENGTH templates instances)
+	endif ()
+
+	message("${name}: object ${object_size} bytes, text ${text_size} bytes, ${instances} lava.format template instances")
+endforeach ()
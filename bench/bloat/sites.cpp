@@ -0,0 +1,31 @@
+// call sites formatting 3 arguments, one site for each sequence of argument types
+// compiled twice: through the variadic format_s, and through the type-erased vformat_s
+#include <lava/format.h>
+#include <string>
+
+namespace fmt = lava::format::legacy;
+
+#ifdef LAVA_BLOAT_ERASED
+#	define FORMAT fmt::vformat_s
+#else
+#	define FORMAT fmt::format_s
+#endif
+
+#define ARG_0 fmt::decimal(i)
+#define ARG_1 "text: "
+#define ARG_2 s
+#define ARG_3 fmt::hexadecimal(u)
+#define ARG_4 static_cast<double>(i) / 8
+#define SITE(a, b, c)                                                                                                 \
+	void site_##a##b##c(                                                                                              \
+		std::string& res, [[maybe_unused]] int i, [[maybe_unused]] unsigned u, [[maybe_unused]] const std::string& s) \
+	{                                                                                                                 \
+		FORMAT(res, ARG_##a, ARG_##b, ARG_##c);                                                                       \
+	}
+#define SITES_2(a, b) SITE(a, b, 0) SITE(a, b, 1) SITE(a, b, 2) SITE(a, b, 3) SITE(a, b, 4)
+#define SITES_1(a) SITES_2(a, 0) SITES_2(a, 1) SITES_2(a, 2) SITES_2(a, 3) SITES_2(a, 4)
+SITES_1(0)
+SITES_1(1)
+SITES_1(2)
+SITES_1(3)
+SITES_1(4)
@@ -0,0 +1,604 @@
+#include "harness.h"
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <lava/config/catalog.h>
+#include <lava/format.h>
+#include <lava/format/legacy/bytes.h>
+#include <lava/format/legacy/json.h>
+#include <lava/log.h>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if __has_include(<fcntl.h>)
+#	include <fcntl.h>
+#endif
+
+// count heap allocations made by the code under benchmark
+void* operator new(size_t n)
+{
+	bench::count_allocation();
+	if (void* p = std::malloc(n ? n : 1))
+		return p;
+	throw std::bad_alloc{};
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace fmt = lava::format::legacy;
+
+// the recursive format_s, appending one argument at a time with no reservation
+namespace recursive
+{
+	inline void format_s(std::string&) {}
+	template<typename U, typename... Us>
+	inline void format_s(std::string& res, U&& x, Us&&... xs)
+	{
+		fmt::format_trait<std::decay_t<U>>::format_append(res, std::forward<U>(x));
+		format_s(res, std::forward<Us>(xs)...);
+	}
+} // namespace recursive
+
+// a stream buffer discarding everything written to it, but counting it
+class null_buffer : public std::streambuf
+{
+public:
+	size_t count{0};
+
+protected:
+	std::streamsize xsputn(const char*, std::streamsize n) override
+	{
+		count += static_cast<size_t>(n);
+		return n;
+	}
+	int_type overflow(int_type c) override
+	{
+		++count;
+		return traits_type::not_eof(c);
+	}
+};
+
+// append the output of snprintf to `res`
+template<typename... Args>
+size_t append_printf(std::string& res, const char* f, Args... args)
+{
+	char buffer[256];
+	const int n = std::snprintf(buffer, sizeof(buffer), f, args...);
+	if (n < 0)
+		return res.size();
+	const auto length = static_cast<size_t>(n);
+	if (length < sizeof(buffer))
+		res.append(buffer, length);
+	else
+	{
+		// truncated: print again, right into `res`
+		const size_t old = res.size();
+		res.resize(old + length + 1);
+		std::snprintf(res.data() + old, length + 1, f, args...);
+		res.resize(old + length);
+	}
+	return res.size();
+}
+
+// a telemetry record, mostly text
+struct telemetry
+{
+	uint64_t id;
+	std::string user;
+	std::string path;
+	std::string message;
+	double latency;
+	std::vector<std::string> tags;
+};
+template<>
+struct fmt::json_trait<telemetry>
+{
+	static auto to_json(const telemetry& r)
+	{
+		return fmt::json_object(
+			fmt::json_field("id", r.id), fmt::json_field("user", r.user), fmt::json_field("path", r.path),
+			fmt::json_field("message", r.message), fmt::json_field("latency", r.latency), fmt::json_field("tags", r.tags));
+	}
+};
+
+int main(int argc, char** argv)
+{
+	bench::suite suite{argc, argv};
+	constexpr size_t n = 1000000;
+	const std::string user = "some-user@example.com";
+	const std::string path = "/api/v1/objects/0123456789abcdef/attributes";
+	std::string buffer;
+	null_buffer null;
+	std::ostream os{&null};
+	// reset `buffer`, return it for appending
+	const auto clear = [&buffer]() -> std::string& {
+		buffer.clear();
+		return buffer;
+	};
+	// the count of bytes written to `os` by `f`
+	const auto streamed = [&null](auto&& f) {
+		const size_t before = null.count;
+		f();
+		return null.count - before;
+	};
+
+	// a typical log line: many small pieces
+#define LOG_LINE(i)                                                                      \
+	"[", fmt::decimal(i), "] ", "request from ", user, " to ", path, ": status=",        \
+		fmt::decimal(200), ", bytes=", fmt::decimal(i * 37), ", id=", fmt::hexadecimal(i), \
+		", retry=", false, fmt::endl
+
+	suite.run("log line", "format_s, recursive", n, [&](size_t i) {
+		std::string res;
+		recursive::format_s(res, LOG_LINE(i));
+		return res.size();
+	});
+	suite.run("log line", "format_s", n, [&](size_t i) {
+		std::string res;
+		fmt::format_s(res, LOG_LINE(i));
+		return res.size();
+	});
+	suite.run("log line", "format string", n, [&](size_t i) {
+		return lava::format::format(
+				   fmtString("[{}] request from {} to {}: status={}, bytes={}, id={:X}, retry={}\n"),
+				   i, user, path, 200, i * 37, i, false)
+			.size();
+	});
+	suite.run("log line", "snprintf", n, [&](size_t i) {
+		std::string res;
+		return append_printf(res, "[%zu] request from %s to %s: status=%d, bytes=%zu, id=%zX, retry=%s\n",
+							 i, user.c_str(), path.c_str(), 200, i * 37, i, "false");
+	});
+	suite.run("log line", "std::ostringstream", n, [&](size_t i) {
+		std::ostringstream ss;
+		ss << '[' << i << "] request from " << user << " to " << path << ": status=" << 200
+		   << ", bytes=" << i * 37 << ", id=" << std::hex << std::uppercase << i << ", retry=" << std::boolalpha << false << '\n';
+		return ss.str().size();
+	});
+
+	// appending many lines to one growing buffer, cleared periodically
+	suite.run("log line, shared buffer", "format_s, recursive", n, [&](size_t i) {
+		if (i % 1024 == 0)
+			std::string{}.swap(buffer);
+		const size_t before = buffer.size();
+		recursive::format_s(buffer, LOG_LINE(i));
+		return buffer.size() - before;
+	});
+	suite.run("log line, shared buffer", "format_s", n, [&](size_t i) {
+		if (i % 1024 == 0)
+			std::string{}.swap(buffer);
+		const size_t before = buffer.size();
+		fmt::format_s(buffer, LOG_LINE(i));
+		return buffer.size() - before;
+	});
+
+	// streaming to an std::ostream
+	suite.run("log line, ostream", "format_io, temporary string", n, [&](size_t i) {
+		return streamed([&] { os << fmt::format(LOG_LINE(i)); });
+	});
+	suite.run("log line, ostream", "format_io", n, [&](size_t i) {
+		return streamed([&] { fmt::format_io(os, LOG_LINE(i)); });
+	});
+	suite.run("log line, ostream", "operator<<", n, [&](size_t i) {
+		return streamed([&] {
+			os << std::dec << '[' << i << "] request from " << user << " to " << path << ": status=" << 200
+			   << ", bytes=" << i * 37 << ", id=" << std::hex << i << ", retry=" << std::boolalpha << false << '\n';
+		});
+	});
+
+	// intermediate text, e.g. a message handed to a logger
+	suite.run("log line, intermediate", "format", n, [&](size_t i) { return fmt::format(LOG_LINE(i)).size(); });
+	suite.run("log line, intermediate", "format_scoped", n, [&](size_t i) { return fmt::format_scoped(LOG_LINE(i)).size(); });
+	suite.run("log line, intermediate", "vformat_scoped, type-erased", n, [&](size_t i) { return fmt::vformat_scoped(LOG_LINE(i)).size(); });
+
+	// an error message, localized: formatted from the macros of LANGUAGE, or from the catalog
+	suite.run("error message", "msg_error_msg macro", n, [&](size_t i) {
+		fmt::format_s(clear(), msg_error_msg(msg_error, __FILE__, fmt::decimal(i), __func__, path));
+		return buffer.size();
+	});
+	suite.run("error message", "catalog, pre-rendered", n, [&](size_t i) {
+		namespace config = lava::config;
+		fmt::format_s(clear(), config::tr(config::message::error_msg, config::tr(config::message::error), __FILE__, fmt::decimal(i), __func__, path));
+		return buffer.size();
+	});
+
+	// the cost paid by the logging thread: the arguments are copied, formatted on a background thread
+	{
+		lava::log::logger log{[](const char*, size_t) { return true; }};
+		suite.run("log line, async", "logger::log", n, [&](size_t i) {
+			log.log(LOG_LINE(i));
+			return size_t{0};
+		});
+		log.flush();
+	}
+	suite.run("log line, async", "format_io, synchronous", n, [&](size_t i) {
+		return streamed([&] { fmt::format_io(os, LOG_LINE(i)); });
+	});
+#undef LOG_LINE
+
+	// integers in each base
+	const auto value = [](size_t i) { return static_cast<int64_t>(i * 0x9E3779B97F4A7C15ull) >> (i % 64); };
+	const auto uvalue = [&value](size_t i) { return static_cast<uint64_t>(value(i)); };
+	const auto to_chars = [&](auto x, int base) {
+		char digits[72];
+		return clear().append(digits, std::to_chars(digits, digits + sizeof(digits), x, base).ptr).size();
+	};
+	const auto ostringstream = [](auto x, auto& manipulator) {
+		std::ostringstream ss;
+		ss << manipulator << x;
+		return ss.str().size();
+	};
+	suite.run("decimal", "num_base", n, [&](size_t i) {
+		fmt::format_s(clear(), fmt::decimal(value(i)));
+		return buffer.size();
+	});
+	suite.run("decimal", "std::to_chars", n, [&](size_t i) { return to_chars(value(i), 10); });
+	suite.run("decimal", "snprintf", n, [&](size_t i) { return append_printf(clear(), "%" PRId64, value(i)); });
+	suite.run("decimal", "std::ostringstream", n, [&](size_t i) { return ostringstream(value(i), std::dec); });
+	suite.run("hexadecimal", "num_base", n, [&](size_t i) {
+		fmt::format_s(clear(), fmt::hexadecimal(uvalue(i)));
+		return buffer.size();
+	});
+	suite.run("hexadecimal", "std::to_chars", n, [&](size_t i) { return to_chars(uvalue(i), 16); });
+	suite.run("hexadecimal", "snprintf", n, [&](size_t i) { return append_printf(clear(), "%" PRIX64, uvalue(i)); });
+	suite.run("hexadecimal", "std::ostringstream", n, [&](size_t i) { return ostringstream(uvalue(i), std::hex); });
+	suite.run("octal", "num_base", n, [&](size_t i) {
+		fmt::format_s(clear(), fmt::octal(uvalue(i)));
+		return buffer.size();
+	});
+	suite.run("octal", "std::to_chars", n, [&](size_t i) { return to_chars(uvalue(i), 8); });
+	suite.run("octal", "snprintf", n, [&](size_t i) { return append_printf(clear(), "%" PRIo64, uvalue(i)); });
+	suite.run("octal", "std::ostringstream", n, [&](size_t i) { return ostringstream(uvalue(i), std::oct); });
+	suite.run("binary", "num_base", n, [&](size_t i) {
+		fmt::format_s(clear(), fmt::binary(uvalue(i)));
+		return buffer.size();
+	});
+	suite.run("binary", "std::to_chars", n, [&](size_t i) { return to_chars(uvalue(i), 2); });
+#ifdef __SIZEOF_INT128__
+	suite.run("hexadecimal 128-bit", "num_base", n, [&](size_t i) {
+		fmt::format_s(clear(), fmt::hexadecimal(static_cast<fmt::detail::uint128_t>(uvalue(i)) << 64 | uvalue(i + 1)));
+		return buffer.size();
+	});
+	suite.run("decimal 128-bit", "num_base", n, [&](size_t i) {
+		fmt::format_s(clear(), fmt::decimal(static_cast<fmt::detail::uint128_t>(uvalue(i)) << 64 | uvalue(i + 1)));
+		return buffer.size();
+	});
+#endif
+
+	// floating-point numbers
+	const auto real = [](size_t i) { return static_cast<double>(i * 0x9E3779B97F4A7C15ull >> 11) * 0x1p-40; };
+	suite.run("double shortest", "format_s", n, [&](size_t i) {
+		fmt::format_s(clear(), real(i));
+		return buffer.size();
+	});
+	suite.run("double shortest", "std::to_chars", n, [&](size_t i) {
+		char digits[32];
+		return clear().append(digits, std::to_chars(digits, digits + 32, real(i)).ptr).size();
+	});
+	suite.run("double shortest", "snprintf %.17g", n, [&](size_t i) { return append_printf(clear(), "%.17g", real(i)); });
+	suite.run("double shortest", "std::ostringstream", n / 10, [&](size_t i) {
+		std::ostringstream ss;
+		ss << std::setprecision(17) << real(i);
+		return ss.str().size();
+	});
+	suite.run("double fixed", "format_s", n, [&](size_t i) {
+		fmt::format_s(clear(), fmt::fixed(real(i)));
+		return buffer.size();
+	});
+	suite.run("double fixed", "std::to_chars", n, [&](size_t i) {
+		char digits[32];
+		return clear().append(digits, std::to_chars(digits, digits + 32, real(i), std::chars_format::fixed, 6).ptr).size();
+	});
+	suite.run("double fixed", "snprintf", n, [&](size_t i) { return append_printf(clear(), "%f", real(i)); });
+	suite.run("double fixed", "std::ostringstream", n / 10, [&](size_t i) {
+		std::ostringstream ss;
+		ss << std::fixed << real(i);
+		return ss.str().size();
+	});
+
+	// strings
+	suite.run("strings", "format_s", n, [&](size_t) {
+		fmt::format_s(clear(), "user ", user, " requested ", path);
+		return buffer.size();
+	});
+	suite.run("strings", "operator+", n, [&](size_t) {
+		return (clear() += "user " + user + " requested " + path).size();
+	});
+	suite.run("strings", "snprintf", n, [&](size_t) {
+		return append_printf(clear(), "user %s requested %s", user.c_str(), path.c_str());
+	});
+	suite.run("strings", "std::ostringstream", n, [&](size_t) {
+		std::ostringstream ss;
+		ss << "user " << user << " requested " << path;
+		return ss.str().size();
+	});
+
+	// escaping a large payload with few characters to escape
+	std::string payload;
+	for (size_t i = 0; payload.size() < 64 * 1024; ++i)
+		fmt::format_s(payload, "id=", fmt::decimal(i), ", name=item-", fmt::decimal(i * 7), i % 8 == 7 ? "\n" : "; ");
+	suite.run("literal 64 KiB", "to_literal per character", n / 1000, [&](size_t) {
+		std::string& res = clear();
+		res.push_back('"');
+		for (char c : payload)
+			fmt::to_literal(c, res);
+		res.push_back('"');
+		return res.size();
+	});
+	suite.run("literal 64 KiB", "literal", n / 1000, [&](size_t) {
+		fmt::format_s(clear(), fmt::literal(std::string_view(payload)));
+		return buffer.size();
+	});
+	suite.run("literal 64 KiB", "std::quoted", n / 1000, [&](size_t) {
+		std::ostringstream ss;
+		ss << std::quoted(payload);
+		return ss.str().size();
+	});
+
+	// aligned columns of a table
+	const auto row = [&](size_t i) {
+		return std::tuple(fmt::left(24, user), fmt::right(8, fmt::decimal(i)), fmt::center(48, path), fmt::right_fill(6, '0', fmt::hexadecimal(i)));
+	};
+	suite.run("aligned row", "eager fill_t", n, [&](size_t i) {
+		const auto [a, b, c, d] = row(i);
+		fmt::format_s(clear(), fmt::fill_t(a), fmt::fill_t(b), fmt::fill_t(c), fmt::fill_t(d), fmt::endl);
+		return buffer.size();
+	});
+	suite.run("aligned row", "in place", n, [&](size_t i) {
+		const auto [a, b, c, d] = row(i);
+		fmt::format_s(clear(), a, b, c, d, fmt::endl);
+		return buffer.size();
+	});
+	suite.run("aligned row", "format_io", n, [&](size_t i) {
+		const auto [a, b, c, d] = row(i);
+		return streamed([&] { fmt::format_io(os, a, b, c, d, fmt::endl); });
+	});
+	suite.run("aligned row", "format string", n, [&](size_t i) {
+		lava::format::format_to(clear(), fmtString("{:<24}{:>8}{:^48}{:06X}\n"), user, i, path, i);
+		return buffer.size();
+	});
+	suite.run("aligned row", "snprintf", n, [&](size_t i) {
+		// snprintf has no centering: pad by hand
+		const int l = static_cast<int>(48 - path.size()) / 2, r = static_cast<int>(48 - path.size()) - l;
+		return append_printf(clear(), "%-24s%8zu%*s%s%*s%06zX\n", user.c_str(), i, l, "", path.c_str(), r, "", i);
+	});
+	suite.run("aligned row", "std::ostringstream", n, [&](size_t i) {
+		std::ostringstream ss;
+		const size_t l = (48 - path.size()) / 2;
+		ss << std::left << std::setw(24) << user << std::right << std::setw(8) << i
+		   << std::string(l, ' ') << path << std::string(48 - path.size() - l, ' ')
+		   << std::setw(6) << std::setfill('0') << std::hex << std::uppercase << i << '\n';
+		return ss.str().size();
+	});
+
+	// coloured messages
+	fmt::set_colour_policy(fmt::colour_policy::always);
+	suite.run("ansi", "format_s", n, [&](size_t i) {
+		fmt::format_s(clear(), mkAnsi(fmt::ErrorColour, "error"), ": ", mkAnsi(fmt::Yellow, path), ':', fmt::decimal(i), fmt::endl);
+		return buffer.size();
+	});
+	suite.run("ansi", "snprintf", n, [&](size_t i) {
+		return append_printf(clear(), "\033[1;91m%s\033[0m: \033[33m%s\033[0m:%zu\n", "error", path.c_str(), i);
+	});
+	suite.run("ansi", "std::ostringstream", n, [&](size_t i) {
+		std::ostringstream ss;
+		ss << "\033[1;91m" << "error" << "\033[0m: \033[33m" << path << "\033[0m:" << i << '\n';
+		return ss.str().size();
+	});
+	fmt::set_colour_policy(fmt::colour_policy::never);
+	suite.run("ansi", "format_s, colour disabled", n, [&](size_t i) {
+		fmt::format_s(clear(), mkAnsi(fmt::ErrorColour, "error"), ": ", mkAnsi(fmt::Yellow, path), ':', fmt::decimal(i), fmt::endl);
+		return buffer.size();
+	});
+
+	// tuples and containers
+	suite.run("tuple", "format_s", n, [&](size_t i) {
+		fmt::format_s(clear(), std::tuple('a', std::string_view(user), fmt::decimal(i), fmt::hexadecimal(i)));
+		return buffer.size();
+	});
+	suite.run("tuple", "snprintf", n, [&](size_t i) {
+		return append_printf(clear(), "<%c,%s,%zu,%zX>", 'a', user.c_str(), i, i);
+	});
+	suite.run("tuple", "std::ostringstream", n, [&](size_t i) {
+		std::ostringstream ss;
+		ss << '<' << 'a' << ',' << user << ',' << i << ',' << std::hex << std::uppercase << i << '>';
+		return ss.str().size();
+	});
+	std::vector<int> numbers(100);
+	for (size_t i = 0; i != numbers.size(); ++i)
+		numbers[i] = static_cast<int>(value(i));
+	suite.run("container of 100 int", "apply", n / 100, [&](size_t) {
+		fmt::format_s(clear(), fmt::apply<fmt::num_base<int>>(numbers));
+		return buffer.size();
+	});
+	suite.run("container of 100 int", "std::to_chars", n / 100, [&](size_t) {
+		std::string& res = clear();
+		char digits[16];
+		res.push_back('{');
+		for (size_t i = 0; i != numbers.size(); ++i)
+		{
+			if (i != 0)
+				res.push_back(',');
+			res.append(digits, std::to_chars(digits, digits + sizeof(digits), numbers[i]).ptr);
+		}
+		res.push_back('}');
+		return res.size();
+	});
+	suite.run("container of 100 int", "std::ostringstream", n / 100, [&](size_t) {
+		std::ostringstream ss;
+		ss << '{';
+		for (size_t i = 0; i != numbers.size(); ++i)
+			ss << (i != 0 ? "," : "") << numbers[i];
+		ss << '}';
+		return ss.str().size();
+	});
+
+	// metrics export: large arrays of 64-bit counters
+	std::vector<std::uint64_t> counters(10000);
+	for (size_t i = 0; i != counters.size(); ++i)
+		counters[i] = static_cast<std::uint64_t>(value(i)) * (i % 7 == 0 ? 1000003u : 1u);
+	suite.run("10k uint64", "format_to per element", n / 1000, [&](size_t) {
+		std::string& res = clear();
+		res.push_back('{');
+		for (size_t i = 0; i != counters.size(); ++i)
+			fmt::format_to(res, i != 0 ? "," : "", fmt::decimal(counters[i]));
+		res.push_back('}');
+		return res.size();
+	});
+	suite.run("10k uint64", "apply decimal", n / 1000, [&](size_t) {
+		fmt::format_s(clear(), fmt::apply<fmt::num_base<std::uint64_t>>(counters));
+		return buffer.size();
+	});
+	suite.run("10k uint64", "apply hexadecimal", n / 1000, [&](size_t) {
+		fmt::format_s(clear(), fmt::apply<fmt::hex_t<std::uint64_t>>(counters));
+		return buffer.size();
+	});
+
+	// Unicode: mostly ASCII text with some CJK
+	std::u16string wide;
+	for (size_t i = 0; wide.size() < 32 * 1024; ++i)
+		wide += i % 16 == 0 ? u"状态: 正常; " : u"status: normal; ";
+	const std::string narrow = fmt::format(wide);
+	suite.run("unicode 32 Ki units", "UTF-16 to UTF-8", n / 1000, [&](size_t) {
+		fmt::format_s(clear(), wide);
+		return buffer.size();
+	});
+	suite.run("unicode 32 Ki units", "UTF-8 validation", n / 1000, [&](size_t) {
+		return fmt::is_valid_utf8(narrow) ? narrow.size() : 0;
+	});
+	suite.run("unicode 32 Ki units", "UTF-8 display width", n / 1000, [&](size_t) {
+		bench::keep(fmt::display_width(narrow));
+		return narrow.size();
+	});
+
+	// a large record set, formatted serially and on all the cores
+	std::vector<std::pair<size_t, double>> records(1000000);
+	for (size_t i = 0; i != records.size(); ++i)
+		records[i] = {i, static_cast<double>(i) / 7};
+	const auto record = [&](std::string& res, const std::pair<size_t, double>& r) {
+		fmt::format_to(res, fmt::decimal(r.first), ',', user, ',', r.second, fmt::endl);
+	};
+	suite.run("1M records", "format_batch on 1 thread", 3, [&](size_t) {
+		return fmt::format_batch(records, record, 1).size();
+	});
+	suite.run("1M records", "format_batch on all cores", 3, [&](size_t) {
+		return fmt::format_batch(records, record).size();
+	});
+
+	// a table of 10k rows, aligned by hand or measured
+	std::vector<std::vector<std::string>> rows;
+	for (size_t i = 0; i != 10000; ++i)
+		rows.push_back({fmt::format(fmt::decimal(i)), user, path, fmt::format(static_cast<double>(i) / 7)});
+	suite.run("table 10k rows", "fill_t per cell", n / 1000, [&](size_t) {
+		std::string& res = clear();
+		for (const auto& r : rows)
+			fmt::format_to(res, fmt::fill_t{r[0], 6, fmt::alignment::right, ' '}, "  ", fmt::fill_t{r[1], 12, fmt::alignment::left, ' '}, "  ",
+						   fmt::fill_t{r[2], 24, fmt::alignment::left, ' '}, "  ", r[3], fmt::endl);
+		return res.size();
+	});
+	suite.run("table 10k rows", "left/right per cell", n / 1000, [&](size_t) {
+		std::string& res = clear();
+		for (const auto& r : rows)
+			fmt::format_to(res, fmt::right(6, r[0]), "  ", fmt::left(12, r[1]), "  ", fmt::left(24, r[2]), "  ", r[3], fmt::endl);
+		return res.size();
+	});
+	suite.run("table 10k rows", "table", n / 1000, [&](size_t) {
+		fmt::format_s(clear(), fmt::table(rows, "><<<"));
+		return buffer.size();
+	});
+
+	// JSON telemetry: records serialized through json_trait, or assembled by hand with C-style quoting
+	std::vector<telemetry> records_json;
+	for (uint64_t i = 0; i != 10000; ++i)
+		records_json.push_back({i * 7919, user, path,
+								"request served from cache after revalidation; upstream replied 304 Not Modified, \"etag\" matched",
+								static_cast<double>(i) / 7, {"cache", "http", "edge"}});
+	suite.run("json 10k records", "literal, by hand", n / 1000, [&](size_t) {
+		std::string& res = clear();
+		res.push_back('[');
+		for (const auto& r : records_json)
+			fmt::format_to(res, "{\"id\":", fmt::decimal(r.id), ",\"user\":", fmt::literal(r.user), ",\"path\":", fmt::literal(r.path),
+						   ",\"message\":", fmt::literal(r.message), ",\"latency\":", r.latency, ",\"tags\":[", fmt::literal(r.tags[0]), ',',
+						   fmt::literal(r.tags[1]), ',', fmt::literal(r.tags[2]), "]},");
+		res.back() = ']';
+		return res.size();
+	});
+	suite.run("json 10k records", "json", n / 1000, [&](size_t) {
+		fmt::format_s(clear(), fmt::json(records_json));
+		return buffer.size();
+	});
+
+	// encoding a large binary buffer
+	std::string blob(1 << 20, '\0');
+	for (size_t i = 0; i != blob.size(); ++i)
+		blob[i] = static_cast<char>(i * 2654435761u >> 13);
+	suite.run("bytes 1 MiB", "snprintf %02X per byte", n / 10000, [&](size_t) {
+		std::string& res = clear();
+		char buf[4];
+		for (char c : blob)
+			res.append(buf, static_cast<size_t>(std::snprintf(buf, sizeof buf, "%02X", static_cast<unsigned char>(c))));
+		return res.size();
+	});
+	suite.run("bytes 1 MiB", "hex", n / 10000, [&](size_t) {
+		fmt::format_s(clear(), fmt::hex(blob));
+		return buffer.size();
+	});
+	suite.run("bytes 1 MiB", "base64", n / 10000, [&](size_t) {
+		fmt::format_s(clear(), fmt::base64(blob));
+		return buffer.size();
+	});
+	suite.run("bytes 1 MiB", "hexdump", n / 10000, [&](size_t) {
+		fmt::format_s(clear(), fmt::hexdump(blob));
+		return buffer.size();
+	});
+
+	// the timestamp prefix of log lines, a microsecond apart
+	const auto start = std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::system_clock::now());
+	suite.run("timestamp", "gmtime_r + strftime + snprintf", n, [&](size_t i) {
+		const auto t = start + std::chrono::microseconds{i};
+		const auto us = t.time_since_epoch().count();
+		const std::time_t s = static_cast<std::time_t>(us / 1000000);
+		std::tm tm{};
+		gmtime_r(&s, &tm);
+		char buf[32];
+		size_t k = std::strftime(buf, sizeof buf, "%Y-%m-%d %H:%M:%S", &tm);
+		k += static_cast<size_t>(std::snprintf(buf + k, sizeof buf - k, ".%06d", static_cast<int>(us % 1000000)));
+		clear().append(buf, k);
+		return buffer.size();
+	});
+	suite.run("timestamp", "format_s", n, [&](size_t i) {
+		fmt::format_s(clear(), start + std::chrono::microseconds{i});
+		return buffer.size();
+	});
+
+#ifdef LAVA_FORMAT_HAS_GATHER_SINK
+	// logging a response body, written to /dev/null
+	const int devnull = ::open("/dev/null", O_WRONLY);
+	const std::string body(16 << 10, 'b');
+	suite.run("16 KiB body to fd", "format_s + write", n / 100, [&](size_t i) {
+		fmt::format_s(clear(), "[", fmt::decimal(i), "] response ", fmt::decimal(200), ": ", body, fmt::endl);
+		return static_cast<size_t>(::write(devnull, buffer.data(), buffer.size()));
+	});
+	suite.run("16 KiB body to fd", "format_fd", n / 100, [&](size_t i) {
+		fmt::format_fd(devnull, "[", fmt::decimal(i), "] response ", fmt::decimal(200), ": ", body, fmt::endl);
+		return body.size();
+	});
+	suite.run("16 KiB body to fd", "format_gather", n / 100, [&](size_t i) {
+		fmt::format_gather(devnull, "[", fmt::decimal(i), "] response ", fmt::decimal(200), ": ", body, fmt::endl);
+		return body.size();
+	});
+	::close(devnull);
+#endif
+
+	return suite.report();
+}
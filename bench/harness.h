@@ -0,0 +1,119 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// a self-contained benchmark harness
+// each case reports ns/op, bytes/s and heap allocations/op, as a table or as JSON
+// the executable counts allocations by replacing the global operator new, see `count_allocation`
+namespace bench
+{
+	inline std::atomic<size_t> allocations{0};
+
+	// call this from the replaced global operator new
+	inline void count_allocation() noexcept { allocations.fetch_add(1, std::memory_order_relaxed); }
+
+	// keep `x` alive so that the optimizer cannot drop the work producing it
+	template<typename T>
+	inline void keep(const T& x)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "g"(&x) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &x;
+#endif
+	}
+
+	struct result
+	{
+		std::string group; // what is formatted
+		std::string name;  // how it is formatted
+		size_t iterations;
+		double ns_per_op;
+		double bytes_per_second;
+		double allocs_per_op;
+	};
+
+	// options: --json for JSON output, --filter=TEXT to run only the groups containing TEXT,
+	// --scale=X to multiply the iterations by X
+	class suite
+	{
+	public:
+		suite(int argc, char** argv)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				if (std::strcmp(argv[i], "--json") == 0)
+					json = true;
+				else if (std::strncmp(argv[i], "--filter=", 9) == 0)
+					filter = argv[i] + 9;
+				else if (std::strncmp(argv[i], "--scale=", 8) == 0)
+					scale = std::atof(argv[i] + 8);
+				else
+				{
+					std::fprintf(stderr, "usage: %s [--json] [--filter=TEXT] [--scale=X]\n", argv[0]);
+					std::exit(2);
+				}
+			}
+		}
+
+		// run `f(i)` for i in [0, n), `f` returning the count of bytes it produced
+		template<typename F>
+		void run(const char* group, const char* name, size_t n, F&& f)
+		{
+			if (!filter.empty() && std::strstr(group, filter.c_str()) == nullptr)
+				return;
+			n = std::max<size_t>(1, static_cast<size_t>(static_cast<double>(n) * scale));
+			// warm up caches, branch predictors and buffers kept across iterations
+			for (size_t i = 0; i < n && i < 100; ++i)
+				keep(f(i));
+
+			size_t bytes = 0;
+			const size_t alloc0 = allocations.load();
+			const auto t0 = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < n; ++i)
+				bytes += f(i);
+			const auto t1 = std::chrono::steady_clock::now();
+			const size_t alloc1 = allocations.load();
+			keep(bytes);
+
+			const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+			result r{group, name, n, ns / n, ns == 0 ? 0 : bytes * 1e9 / ns, double(alloc1 - alloc0) / n};
+			if (!json)
+				std::printf("%-24s %-36s %12.1f ns/op %10.1f MB/s %8.2f allocs/op\n",
+							group, name, r.ns_per_op, r.bytes_per_second / 1e6, r.allocs_per_op);
+			results.push_back(std::move(r));
+		}
+
+		// print the JSON report, if asked to
+		int report() const
+		{
+			if (!json)
+				return 0;
+			std::printf("[\n");
+			for (size_t i = 0; i != results.size(); ++i)
+			{
+				const result& r = results[i];
+				std::printf(
+					"  {\"group\": \"%s\", \"name\": \"%s\", \"iterations\": %zu, "
+					"\"ns_per_op\": %.3f, \"bytes_per_second\": %.0f, \"allocs_per_op\": %.3f}%s\n",
+					r.group.c_str(), r.name.c_str(), r.iterations, r.ns_per_op,
+					r.bytes_per_second, r.allocs_per_op, i + 1 == results.size() ? "" : ",");
+			}
+			std::printf("]\n");
+			return 0;
+		}
+
+	private:
+		bool json{false};
+		std::string filter{};
+		double scale{1};
+		std::vector<result> results{};
+	};
+} // namespace bench
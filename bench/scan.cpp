@@ -0,0 +1,81 @@
+#include "harness.h"
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <lava/format.h>
+#include <lava/scan.h>
+#include <new>
+#include <string>
+#include <vector>
+
+// count heap allocations made by the code under benchmark
+void* operator new(size_t n)
+{
+	bench::count_allocation();
+	if (void* p = std::malloc(n ? n : 1))
+		return p;
+	throw std::bad_alloc{};
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace fmt = lava::format::legacy;
+
+int main(int argc, char** argv)
+{
+	bench::suite suite{argc, argv};
+	constexpr size_t n = 1000000;
+
+	// numbers formatted by lava.format, each followed by a space as in a log line
+	const auto make = [](auto f) {
+		std::vector<std::string> texts(1024);
+		for (size_t i = 0; i != texts.size(); ++i)
+			texts[i] = fmt::format(f(i * 0x9E3779B97F4A7C15ull), ' ');
+		return texts;
+	};
+	const auto decimal = make([](uint64_t x) { return fmt::decimal(x >> (x % 64)); });
+	const auto long_decimal = make([](uint64_t x) { return fmt::decimal(x % 9000000000000000000ull + 1000000000000000000ull); });
+	const auto hexadecimal = make([](uint64_t x) { return fmt::hexadecimal(x >> (x % 64)); });
+
+	const auto run = [&](const char* group, const std::vector<std::string>& texts, int base) {
+		suite.run(group, "lava::scan", n, [&](size_t i) {
+			const std::string& s = texts[i % texts.size()];
+			uint64_t x = 0;
+			const auto r = base == 10 ? lava::scan::scan(s, lava::scan::decimal(x)) : lava::scan::scan(s, lava::scan::hexadecimal(x));
+			bench::keep(x);
+			return static_cast<size_t>(r.ptr - s.data());
+		});
+		suite.run(group, "std::from_chars", n, [&](size_t i) {
+			const std::string& s = texts[i % texts.size()];
+			uint64_t x = 0;
+			const auto r = std::from_chars(s.data(), s.data() + s.size(), x, base);
+			bench::keep(x);
+			return static_cast<size_t>(r.ptr - s.data());
+		});
+		suite.run(group, "strtoull", n, [&](size_t i) {
+			const std::string& s = texts[i % texts.size()];
+			char* end;
+			const uint64_t x = std::strtoull(s.c_str(), &end, base);
+			bench::keep(x);
+			return static_cast<size_t>(end - s.data());
+		});
+	};
+	run("decimal", decimal, 10);
+	run("decimal 19 digits", long_decimal, 10);
+	run("hexadecimal", hexadecimal, 16);
+
+	// a whole log line
+	const std::string line = fmt::format("[", fmt::decimal(1234567), "] id=", fmt::hexadecimal(0xDEADBEEFu), " status=", fmt::decimal(200), " retry=", false);
+	suite.run("log line", "lava::scan", n, [&](size_t) {
+		uint64_t t = 0;
+		unsigned id = 0, status = 0;
+		bool retry = true;
+		const auto r = lava::scan::scan(
+			line, "[", lava::scan::decimal(t), "] id=", lava::scan::hexadecimal(id),
+			" status=", lava::scan::decimal(status), " retry=", retry);
+		bench::keep(t + id + status + retry);
+		return static_cast<size_t>(r.ptr - line.data());
+	});
+
+	return suite.report();
+}
@@ -90,7 +90,7 @@ namespace lava::ascii
 
 	constexpr char toxdigit(char c) noexcept
 	{
-		expects(isdigit(c), "expecting a hexadecimal digit.");
+		expects(isxdigit(c), "expecting a hexadecimal digit.");
 		if (c >= 'a' && c <= 'f')
 			return (c - 'a' + 0xa);
 		if (c >= 'A' && c <= 'F')
@@ -1,7 +1,8 @@
 #pragma once
-#include <lava/config/localization.h>
+#include <lava/config/catalog.h>
 #include <lava/format/legacy.h>
 #include <stdexcept>
+#include <string_view>
 
 // if exceptions are disabled, error messages are printed to `std::cerr`
 #ifdef LAVA_DISABLE_EXCEPTION
@@ -22,17 +23,21 @@ namespace lava
 // user should not call `RaiseError` directly
 // for it is not defined when ASSERT and PANIC are both disabled
 #if !defined(LAVA_DISABLE_PANIC) || !defined(LAVA_DISABLE_ASSERT)
-#	define RaiseError(err, msg) lava::RaiseErrorImpl(__FILE__, __LINE__, __func__, lava::format::legacy::format(err), msg)
+// messages come from the catalog, in the locale of the current thread (see lava::config::tr),
+// intermediate messages are formatted to scratch buffers (see lava::format::legacy::scoped_buffer),
+// through the type-erased vformat_s, so that each assertion only packs its arguments
+#	define RaiseError(err, msg) lava::RaiseErrorImpl(__FILE__, __LINE__, __func__, err, msg)
 	[[noreturn]] inline void RaiseErrorImpl(
 		const char* file, int line, const char* func,
-		const std::string& err, const std::string& msg)
+		std::string_view err, std::string_view msg)
 	{
 #	ifndef LAVA_DISABLE_EXCEPTION
-		std::string err_msg{};
-		lava::format::legacy::format_s(err_msg, msg_error_msg(err, file, lava::format::legacy::decimal(line), func, msg));
-		throw std::runtime_error(err_msg);
+		const auto err_msg = lava::format::legacy::format_scoped(
+			lava::config::tr(lava::config::message::error_msg, err, file, lava::format::legacy::decimal(line), func, msg));
+		throw std::runtime_error(err_msg.str());
 #	else
-		lava::format::legacy::format_io(std::cerr, msg_error_msg(err, file, lava::format::legacy::decimal(line), func, msg));
+		lava::format::legacy::format_io(
+			std::cerr, lava::config::tr(lava::config::message::error_msg, err, file, lava::format::legacy::decimal(line), func, msg));
 		std::quick_exit(1);
 #	endif
 	}
@@ -42,7 +47,7 @@ namespace lava
 // when LAVA_DISABLE_PANIC is defined, `panic` does nothing
 // this option is dangerous, for potential errors get silently ignored
 #ifndef LAVA_DISABLE_PANIC
-#	define panic(...) RaiseError(msg_panic, lava::format::legacy::format(__VA_ARGS__))
+#	define panic(...) RaiseError(lava::config::tr(lava::config::message::panic), lava::format::legacy::vformat_scoped(__VA_ARGS__))
 #else
 #	define panic(...) static_cast<void>(0)
 #endif
@@ -50,10 +55,10 @@ namespace lava
 // `expects`, `ensures`, `invariant`, `unreachable`
 // 4 useful assertions are defined below
 #ifndef LAVA_DISABLE_ASSERT
-#	define expects(cond, ...) AssertImpl(lava::format::legacy::format(msg_error), cond, lava::format::legacy::format(__VA_ARGS__), lava::AssertType::PreCond)
-#	define ensures(cond, ...) AssertImpl(lava::format::legacy::format(msg_error), cond, lava::format::legacy::format(__VA_ARGS__), lava::AssertType::PostCond)
-#	define invariant(cond, ...) AssertImpl(lava::format::legacy::format(msg_error), cond, lava::format::legacy::format(__VA_ARGS__), lava::AssertType::InvarCond)
-#	define unreachable(...) RaiseError(lava::format::legacy::format(msg_error), lava::format::legacy::format(msg_unreachable_code_reached, __VA_ARGS__))
+#	define expects(cond, ...) AssertImpl(lava::config::tr(lava::config::message::error), cond, lava::format::legacy::vformat_scoped(__VA_ARGS__), lava::AssertType::PreCond)
+#	define ensures(cond, ...) AssertImpl(lava::config::tr(lava::config::message::error), cond, lava::format::legacy::vformat_scoped(__VA_ARGS__), lava::AssertType::PostCond)
+#	define invariant(cond, ...) AssertImpl(lava::config::tr(lava::config::message::error), cond, lava::format::legacy::vformat_scoped(__VA_ARGS__), lava::AssertType::InvarCond)
+#	define unreachable(...) RaiseError(lava::config::tr(lava::config::message::error), lava::format::legacy::vformat_scoped(lava::config::tr(lava::config::message::unreachable_code_reached), __VA_ARGS__))
 
 #	ifndef LAVA_DISABLE_EXCEPTION
 // this function throws only when assertions fail in function body
@@ -71,16 +76,15 @@ namespace lava
 			if (!(cond))                                                 \
 				RaiseError(err, lava::AssertionError(#cond, msg, type)); \
 		} while (0)
-	inline std::string
-		AssertionError(const std::string& cond_str, const std::string& msg, lava::AssertType type)
+	inline lava::format::legacy::scoped_buffer
+		AssertionError(std::string_view cond_str, std::string_view msg, lava::AssertType type)
 	{
-		static const char* assert_type_name[]{msg_assert_type_names};
-		std::string err_msg{};
-		lava::format::legacy::format_s(
-			err_msg, assert_type_name[static_cast<int>(type)],
+		constexpr lava::config::message assert_type_name[]{
+			lava::config::message::precondition, lava::config::message::postcondition, lava::config::message::invariant};
+		return lava::format::legacy::format_scoped(
+			lava::config::tr(assert_type_name[static_cast<int>(type)]),
 			'[', mkAnsi(lava::format::legacy::Cyan, cond_str), ']',
-			msg_condition_not_satisfied, msg);
-		return err_msg;
+			lava::config::tr(lava::config::message::condition_not_satisfied), msg);
 	}
 
 #else
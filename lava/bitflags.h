@@ -92,24 +92,24 @@ namespace lava
 		template<typename T>
 		struct format_trait<bitflags<T>>
 		{
-			static void format_append(std::string& res, bitflags<T> flags)
+			template<typename Sink>
+			static void format_append(Sink& res, bitflags<T> flags)
 			{
 				auto x = flags.decay();
-				res.append("[");
+				res.push_back('[');
 				if (x != 0)
 				{
 					auto bit = static_cast<T>(x & -x);
-					res.append(enums::name_of(bit));
+					format_to(res, enums::name_of(bit));
 					x &= x - 1;
 				}
 				while (x != 0)
 				{
 					auto bit = static_cast<T>(x & -x);
-					res.append(", ");
-					res.append(enums::name_of(bit));
+					format_to(res, ", ", enums::name_of(bit));
 					x &= x - 1;
 				}
-				res.append("]");
+				res.push_back(']');
 			}
 		};
 	} // namespace format::legacy
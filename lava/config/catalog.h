@@ -0,0 +1,239 @@
+#pragma once
+#include <atomic>
+#include <lava/config/language.h>
+#include <lava/format/legacy.h>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+// the messages of all the languages, formatted at compile time, chosen at runtime for each thread
+namespace lava::config
+{
+	// the languages, see lava/config/language.h
+	enum class locale : unsigned char
+	{
+		chinese_simplified = CHINESE_SIMPLIFIED,
+		english = ENGLISH
+	};
+	inline constexpr size_t locale_count = 2;
+
+	// the messages in the catalog, used by lava.assert and lava.resource
+	// `error_msg` takes 5 arguments: the error, the file, the line, the function and the message
+	enum class message : unsigned char
+	{
+		error,
+		panic,
+		should_not_move_to_this,
+		unreachable_code_reached,
+		precondition,
+		postcondition,
+		invariant,
+		condition_not_satisfied,
+		error_msg
+	};
+	inline constexpr size_t message_count = 9;
+
+	// a message in the catalog: constant fragments, with an argument written after each but the last
+	class message_text
+	{
+	public:
+		template<size_t N, size_t K>
+		constexpr message_text(const lava::format::legacy::constant_message<N, K>& m)
+			: coloured{m.coloured.text.text}
+			, plain{m.plain.text.text}
+			, coloured_ends{m.coloured.ends}
+			, plain_ends{m.plain.ends}
+			, slots{m.coloured.slots}
+			, count{K}
+		{}
+
+		// the count of arguments
+		constexpr size_t arguments() const noexcept { return count; }
+		// the argument written after fragment `i`
+		constexpr size_t slot(size_t i) const noexcept { return slots[i]; }
+
+		// the fragments of one version of the message
+		struct fragments
+		{
+			const char* text;
+			const size_t* ends;
+
+			constexpr std::string_view operator[](size_t i) const noexcept
+			{
+				const size_t first = i == 0 ? 0 : ends[i - 1];
+				return {text + first, ends[i] - first};
+			}
+		};
+		// the fragments, written as the colour policy chooses
+		fragments select() const
+		{
+#ifndef LAVA_DISABLE_ANSI_ESCAPE_SEQUENCE
+			if (lava::format::legacy::colour_enabled())
+				return {coloured, coloured_ends};
+#endif
+			return {plain, plain_ends};
+		}
+		// the whole text, for messages with no argument
+		std::string_view view() const { return select()[0]; }
+		operator std::string_view() const { return view(); }
+
+	private:
+		const char* coloured;
+		const char* plain;
+		const size_t* coloured_ends;
+		const size_t* plain_ends;
+		const unsigned char* slots;
+		size_t count;
+	};
+
+	namespace detail
+	{
+		inline std::atomic<locale> default_locale{static_cast<locale>(LANGUAGE)};
+
+		// the locale chosen by the current thread, if any
+		inline std::optional<locale>& thread_locale() noexcept
+		{
+			thread_local std::optional<locale> current;
+			return current;
+		}
+	} // namespace detail
+
+	// set the locale of threads which have not chosen one, LANGUAGE by default
+	inline void set_default_locale(locale l) noexcept { detail::default_locale.store(l, std::memory_order_relaxed); }
+	// set the locale of the current thread, which no longer follows the default one
+	inline void set_locale(locale l) noexcept { detail::thread_locale() = l; }
+	// the locale of the current thread: the one it has chosen, or the default one
+	inline locale current_locale() noexcept
+	{
+		const std::optional<locale>& l = detail::thread_locale();
+		return l ? *l : detail::default_locale.load(std::memory_order_relaxed);
+	}
+} // namespace lava::config
+
+// the messages of each language are formatted to constants, in the order of `message`
+#define LAVA_CATALOG_NTH(n, ...) LAVA_CATALOG_NTH_##n(__VA_ARGS__)
+#define LAVA_CATALOG_NTH_0(a, b, c) a
+#define LAVA_CATALOG_NTH_1(a, b, c) b
+#define LAVA_CATALOG_NTH_2(a, b, c) c
+#define LAVA_CATALOG_MESSAGE(...)                                                                                      \
+	lava::format::legacy::format_message<                                                                              \
+		lava::format::legacy::constant_size(__VA_ARGS__), lava::format::legacy::constant_slots(__VA_ARGS__)>(__VA_ARGS__)
+#define LAVA_CATALOG_SLOT(i) lava::format::legacy::slot{i}
+#define LAVA_CATALOG_LANGUAGE(name)                                                                                             \
+	namespace lava::config::detail::name                                                                                       \
+	{                                                                                                                          \
+		inline constexpr auto error = LAVA_CATALOG_MESSAGE(msg_error);                                                         \
+		inline constexpr auto panic = LAVA_CATALOG_MESSAGE(msg_panic);                                                         \
+		inline constexpr auto should_not_move_to_this = LAVA_CATALOG_MESSAGE(msg_should_not_move_to_this);                     \
+		inline constexpr auto unreachable_code_reached = LAVA_CATALOG_MESSAGE(msg_unreachable_code_reached);                   \
+		inline constexpr auto precondition = LAVA_CATALOG_MESSAGE(LAVA_CATALOG_NTH(0, msg_assert_type_names));                 \
+		inline constexpr auto postcondition = LAVA_CATALOG_MESSAGE(LAVA_CATALOG_NTH(1, msg_assert_type_names));                \
+		inline constexpr auto invariant = LAVA_CATALOG_MESSAGE(LAVA_CATALOG_NTH(2, msg_assert_type_names));                    \
+		inline constexpr auto condition_not_satisfied = LAVA_CATALOG_MESSAGE(msg_condition_not_satisfied);                     \
+		inline constexpr auto error_msg = LAVA_CATALOG_MESSAGE(msg_error_msg(                                                  \
+			LAVA_CATALOG_SLOT(0), LAVA_CATALOG_SLOT(1), LAVA_CATALOG_SLOT(2), LAVA_CATALOG_SLOT(3), LAVA_CATALOG_SLOT(4)));    \
+		inline constexpr message_text messages[message_count]{                                                                 \
+			error, panic, should_not_move_to_this, unreachable_code_reached,                                                   \
+			precondition, postcondition, invariant, condition_not_satisfied, error_msg};                                       \
+	}
+
+#include <lava/config/zh-cn.h>
+LAVA_CATALOG_LANGUAGE(chinese_simplified)
+#include <lava/config/en.h>
+LAVA_CATALOG_LANGUAGE(english)
+
+#undef LAVA_CATALOG_LANGUAGE
+#undef LAVA_CATALOG_SLOT
+#undef LAVA_CATALOG_MESSAGE
+#undef LAVA_CATALOG_NTH_2
+#undef LAVA_CATALOG_NTH_1
+#undef LAVA_CATALOG_NTH_0
+#undef LAVA_CATALOG_NTH
+
+// restore the messages of LANGUAGE
+#include <lava/config/localization.h>
+
+namespace lava::config
+{
+	namespace detail
+	{
+		// indexed by locale, then by message
+		inline constexpr const message_text* catalog[locale_count]{
+			chinese_simplified::messages,
+			english::messages};
+	} // namespace detail
+
+	// the message `id` in the locale of the current thread
+	inline const message_text& lookup(message id) noexcept
+	{
+		return detail::catalog[static_cast<size_t>(current_locale())][static_cast<size_t>(id)];
+	}
+
+	// a message with its arguments, formatted lazily
+	template<typename... Us>
+	struct localized
+	{
+		const message_text& text;
+		std::tuple<const Us&...> arguments;
+	};
+
+	// tr: the message `id` in the locale of the current thread
+	// with no argument, the text itself, a std::string_view
+	inline const message_text& tr(message id) noexcept { return lookup(id); }
+	// tr: the message `id` in the locale of the current thread, with its arguments
+	template<typename... Us>
+	inline localized<Us...> tr(message id, const Us&... xs) noexcept
+	{
+		return {lookup(id), std::tuple<const Us&...>{xs...}};
+	}
+} // namespace lava::config
+
+namespace lava::format::legacy
+{
+	template<> // format a message of the catalog
+	struct format_trait<lava::config::message_text>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const lava::config::message_text& m)
+		{
+			const std::string_view s = m.view();
+			res.append(s.data(), s.size());
+		}
+		static size_t formatted_size(const lava::config::message_text& m) { return m.view().size(); }
+		static std::string_view view(const lava::config::message_text& m) { return m.view(); }
+	};
+
+	template<typename... Us> // format a message of the catalog, with its arguments
+	struct format_trait<lava::config::localized<Us...>>
+	{
+		using U = lava::config::localized<Us...>;
+		template<typename Sink>
+		static void format_append(Sink& res, const U& m)
+		{
+			const auto fragments = m.text.select();
+			for (size_t i = 0; i != m.text.arguments(); ++i)
+			{
+				const std::string_view s = fragments[i];
+				res.append(s.data(), s.size());
+				argument(res, m, m.text.slot(i), std::index_sequence_for<Us...>{});
+			}
+			const std::string_view s = fragments[m.text.arguments()];
+			res.append(s.data(), s.size());
+		}
+		static size_t formatted_size(const U& m)
+		{
+			// the fragments end where the text does
+			const size_t n = m.text.select().ends[m.text.arguments()];
+			return n + std::apply([](const auto&... xs) { return legacy::formatted_size(xs...); }, m.arguments);
+		}
+
+	private:
+		// write the argument `k`, chosen at runtime: the translations may reorder them
+		template<typename Sink, size_t... I>
+		static void argument(Sink& res, const U& m, size_t k, std::index_sequence<I...>)
+		{
+			static_cast<void>(((k == I ? (format_to(res, std::get<I>(m.arguments)), true) : false) || ...));
+		}
+	};
+} // namespace lava::format::legacy
@@ -1,4 +1,5 @@
-#pragma once
+// no include guard: each inclusion defines the messages again, see lava/config/catalog.h
+#include <lava/config/reset.h>
 
 #define text_error mkAnsi(lava::format::legacy::ErrorColour, "error")
 #define text_panic mkAnsi(lava::format::legacy::ErrorColour, "panic")
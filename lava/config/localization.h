@@ -1,4 +1,4 @@
-#pragma once
+// no include guard: including it again restores the messages of LANGUAGE, see lava/config/catalog.h
 #include <lava/config/language.h>
 
 #if LANGUAGE == CHINESE_SIMPLIFIED
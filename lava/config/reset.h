@@ -0,0 +1,15 @@
+// no include guard: undefine the messages of the current language, before defining another one
+
+#undef text_error
+#undef text_panic
+#undef text_colon
+#undef text_quote
+
+#undef msg_error
+#undef msg_should_not_move_to_this
+#undef msg_error_msg
+#undef msg_panic
+#undef msg_unreachable_code_reached
+#undef msg_assert_type_names
+#undef msg_condition_not_satisfied
+#undef msg_invalid_enum_value
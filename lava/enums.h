@@ -122,10 +122,10 @@ namespace lava::enums
 		template<typename Idx, Idx from, typename T>
 		struct make_int_seq_helper;
 
-		template<typename Idx, Idx from, Idx... I>
+		template<typename Idx, Idx from, size_t... I>
 		struct make_int_seq_helper<Idx, from, std::integer_sequence<size_t, I...>>
 		{
-			using type = std::integer_sequence<Idx, (from + I)...>;
+			using type = std::integer_sequence<Idx, static_cast<Idx>(from + static_cast<Idx>(I))...>;
 		};
 
 		template<typename Idx, Idx from, Idx to>
@@ -1 +1,2 @@
 #pragma once
+#include <lava/format/core.h>
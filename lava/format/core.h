@@ -0,0 +1,279 @@
+#pragma once
+#include <lava/format/legacy.h>
+#include <lava/format/spec.h>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+
+// lava::format: formatting with format strings parsed at compile time
+// arguments are rendered with the format_trait specializations of lava.format
+namespace lava::format
+{
+	namespace detail
+	{
+		using legacy::format_trait;
+
+		template<typename T>
+		constexpr bool is_integer
+			= (std::is_integral_v<T> && !std::is_same_v<T, bool> && !legacy::is_char<T>)
+#ifdef __SIZEOF_INT128__
+			  || std::is_same_v<T, legacy::detail::int128_t> || std::is_same_v<T, legacy::detail::uint128_t>
+#endif
+			;
+
+		template<typename T>
+		constexpr bool is_text = std::is_same_v<T, const char*> || std::is_same_v<T, char*>
+								 || std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>
+								 || std::is_same_v<T, const char16_t*> || std::is_same_v<T, char16_t*>
+								 || std::is_same_v<T, std::u16string> || std::is_same_v<T, std::u16string_view>
+								 || std::is_same_v<T, const char32_t*> || std::is_same_v<T, char32_t*>
+								 || std::is_same_v<T, std::u32string> || std::is_same_v<T, std::u32string_view>;
+
+		// whether T is a built-in type, or there is a format_trait for T
+		template<typename T, typename = void>
+		struct is_formattable : std::bool_constant<is_integer<T>>
+		{};
+		template<typename T>
+		struct is_formattable<T, std::void_t<decltype(sizeof(format_trait<T>))>> : std::true_type
+		{};
+
+		// an upper bound of the length of the formatted argument, 0 if unknown
+		template<typename T>
+		inline size_t size_hint(const T& x)
+		{
+			if constexpr (is_integer<T>)
+				return format_trait<legacy::num_base<T>>::max_length;
+			else
+				return legacy::formatted_size(x);
+		}
+
+		// numbers are formatted to a stack buffer when padded
+		template<typename T>
+		constexpr bool is_number = is_integer<T> || std::is_same_v<T, char> || std::is_floating_point_v<T>;
+
+		// check the replacement field `sp` against the argument type T
+		template<typename T>
+		constexpr bool accepts(const spec& sp) noexcept
+		{
+			if constexpr (std::is_floating_point_v<T>)
+				return sp.type == '\0' || sp.type == 'f' || sp.type == 'F' || sp.type == 'e'
+					   || sp.type == 'E' || sp.type == 'g' || sp.type == 'G';
+			else if constexpr (is_integer<T> || std::is_same_v<T, char>)
+				return (sp.type == '\0' || sp.type == 'd' || sp.type == 'x' || sp.type == 'X'
+						|| sp.type == 'o' || sp.type == 'O' || sp.type == 'b' || sp.type == 'B'
+						|| (sp.type == 'c' && std::is_same_v<T, char>))
+					   && sp.precision < 0;
+			else if constexpr (is_text<T> || std::is_same_v<T, bool>)
+				return (sp.type == '\0' || sp.type == 's') && sp.align != '=' && sp.precision < 0;
+			else
+				return sp.type == '\0' && sp.align != '=' && sp.precision < 0;
+		}
+
+		// the style of a floating-point number with type `type`
+		constexpr legacy::float_style float_style_of(char type, int precision) noexcept
+		{
+			switch (type)
+			{
+			case 'f':
+			case 'F':
+				return legacy::float_style::fixed;
+			case 'e':
+			case 'E':
+				return legacy::float_style::scientific;
+			case 'g':
+			case 'G':
+				return legacy::float_style::general;
+			default:
+				return precision < 0 ? legacy::float_style::shortest : legacy::float_style::general;
+			}
+		}
+
+		// the base of an integer formatted with type `type`
+		constexpr int base_of(char type) noexcept
+		{
+			return type == 'x' || type == 'X' ? 16 : type == 'o' || type == 'O' ? 8 : type == 'b' || type == 'B' ? 2 : 10;
+		}
+
+		// the maximum length of a number T formatted with type `type`
+		template<typename T, char type, int precision>
+		constexpr size_t number_length() noexcept
+		{
+			if constexpr (std::is_floating_point_v<T>)
+				return legacy::detail::float_length<T>(float_style_of(type, precision), precision);
+			else if constexpr (std::is_same_v<T, char>)
+				return type == '\0' || type == 'c' ? 1 : format_trait<legacy::num_base<int, base_of(type)>>::max_length;
+			else
+				return format_trait<legacy::num_base<T, base_of(type)>>::max_length;
+		}
+
+		// write the argument `x` as specified by type `type` and precision `precision`
+		template<char type, int precision, typename Sink, typename T>
+		inline void write_value(Sink& out, const T& x)
+		{
+			if constexpr (std::is_same_v<T, char> && (type == '\0' || type == 'c'))
+				out.push_back(x);
+			else if constexpr (std::is_same_v<T, char>)
+				write_value<type, precision>(out, static_cast<int>(static_cast<unsigned char>(x)));
+			else if constexpr (is_integer<T>)
+			{
+				constexpr T base = base_of(type);
+				constexpr bool capital = type == 'X' || type == 'O' || type == 'B';
+				format_trait<legacy::num_base<T, base, capital>>::format_append(out, {x});
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				constexpr auto style = float_style_of(type, precision);
+				constexpr bool capital = type == 'F' || type == 'E' || type == 'G';
+				constexpr int p = precision < 0 && style != legacy::float_style::shortest ? 6 : precision;
+				format_trait<legacy::float_base<T, style, capital>>::format_append(out, {x, p});
+			}
+			else
+				legacy::format_to(out, x);
+		}
+
+		template<typename Sink>
+		inline void fill(Sink& out, char c, size_t n)
+		{
+			for (; n != 0; --n)
+				out.push_back(c);
+		}
+
+		// write `write(out)`, `n` columns wide, padded to `width` with `c` as `align` says
+		template<char align, typename Sink, typename F>
+		inline void write_padded(Sink& out, char c, size_t width, size_t n, F&& write)
+		{
+			const size_t pad = n < width ? width - n : 0;
+			fill(out, c, align == '>' ? pad : align == '^' ? pad / 2 : 0);
+			write(out);
+			fill(out, c, align == '<' ? pad : align == '^' ? (pad + 1) / 2 : 0);
+		}
+
+		// write the replacement field I of the format string S
+		template<typename S, size_t I, typename Sink, typename Args>
+		inline void write_segment(Sink& out, const Args& args)
+		{
+			constexpr segment seg = format_plan<S>::segments[I];
+			if constexpr (!seg.is_field)
+				out.append(format_plan<S>::text.data() + seg.begin, seg.size);
+			else
+			{
+				using T = std::decay_t<std::tuple_element_t<seg.index, Args>>;
+				static_assert(is_formattable<T>::value, "lava::format: no format_trait for the argument type.");
+				static_assert(accepts<T>(seg.format), "lava::format: the format specification does not apply to the argument type.");
+				const T& x = std::get<seg.index>(args);
+				constexpr char type = seg.format.type;
+				constexpr int precision = seg.format.precision;
+				auto write = [&x](auto& sink) { write_value<type, precision>(sink, x); };
+				if constexpr (seg.format.width == 0)
+					write(out);
+				else if constexpr (is_number<T>)
+				{
+					// numbers are short: format to a stack buffer, then pad
+					char buffer[number_length<T, type, precision>()];
+					legacy::buffer_sink digits{buffer, sizeof(buffer)};
+					write(digits);
+					const size_t n = digits.size();
+					const size_t pad = n < seg.format.width ? seg.format.width - n : 0;
+					constexpr char align = seg.format.align == '\0' ? '>' : seg.format.align;
+					const char* p = buffer;
+					if (align == '=' && n != 0 && *p == '-')
+						out.push_back(*p++);
+					fill(out, seg.format.fill, align == '>' || align == '=' ? pad : align == '^' ? pad / 2 : 0);
+					out.append(p, n - static_cast<size_t>(p - buffer));
+					fill(out, seg.format.fill, align == '<' ? pad : align == '^' ? (pad + 1) / 2 : 0);
+				}
+				else if constexpr (legacy::has_view<T>::value)
+				{
+					// measured on its text, then written as-is
+					constexpr char align = seg.format.align == '\0' ? '<' : seg.format.align;
+					const size_t n = legacy::display_width(format_trait<T>::view(x));
+					write_padded<align>(out, seg.format.fill, seg.format.width, n, write);
+				}
+				else
+				{
+					// formatted once to a scratch buffer, measured, then written
+					constexpr char align = seg.format.align == '\0' ? '<' : seg.format.align;
+					legacy::scoped_buffer text{};
+					write(text.str());
+					const size_t n = legacy::display_width(text.view());
+					write_padded<align>(out, seg.format.fill, seg.format.width, n, [&text](auto& sink) {
+						sink.append(text.str().data(), text.size());
+					});
+				}
+			}
+		}
+
+		template<typename S, typename Sink, typename Args, size_t... I>
+		inline void write_segments(Sink& out, const Args& args, std::index_sequence<I...>)
+		{
+			(write_segment<S, I>(out, args), ...);
+		}
+
+		template<typename S, typename... Args>
+		constexpr void check_format()
+		{
+			static_assert(is_format_string<S>, "lava::format: the format string should be made with `fmtString`.");
+			using plan = format_plan<S>;
+			static_assert(plan::error != parse_error::unmatched_open, "lava::format: unmatched '{' in the format string.");
+			static_assert(plan::error != parse_error::unmatched_close, "lava::format: unmatched '}' in the format string, use '}}' for a literal '}'.");
+			static_assert(plan::error != parse_error::mixed_indexing, "lava::format: automatic and manual argument indices are mixed.");
+			static_assert(plan::error != parse_error::invalid_spec, "lava::format: invalid format specification.");
+			static_assert(plan::error != parse_error::none || plan::args == sizeof...(Args), "lava::format: the count of arguments does not match the format string.");
+		}
+	} // namespace detail
+
+	// format_to: format the arguments as described by the format string `S` to the sink `out`
+	template<typename Sink, typename S, typename... Args>
+	inline void format_to(Sink& out, S, const Args&... args)
+	{
+		detail::check_format<S, Args...>();
+		using plan = format_plan<S>;
+		if constexpr (plan::error == parse_error::none && plan::args == sizeof...(Args))
+			detail::write_segments<S>(
+				out, std::forward_as_tuple(args...),
+				std::make_index_sequence<plan::segments.size()>{});
+	}
+
+	// format: format the arguments as described by the format string `S`, return the result
+	template<typename S, typename... Args>
+	inline std::string format(S fs, const Args&... args)
+	{
+		std::string res{};
+		res.reserve(format_plan<S>::size_hint + (size_t{0} + ... + detail::size_hint(args)));
+		format_to(res, fs, args...);
+		return res;
+	}
+
+	// format_to_n: format the arguments to `out`, writing at most `n` characters
+	template<typename S, typename... Args>
+	inline legacy::format_to_n_result format_to_n(char* out, size_t n, S fs, const Args&... args)
+	{
+		legacy::buffer_sink sink{out, n};
+		format_to(sink, fs, args...);
+		return {sink.end(), sink.size()};
+	}
+
+	// format_io: format the arguments to output stream `os`
+	template<typename S, typename... Args>
+	inline void format_io(std::ostream& os, S fs, const Args&... args)
+	{
+		const legacy::detail::destination_scope destination{legacy::detail::stream_fd(os)};
+		// a field width applies to the whole text, so it has to be built first, as legacy::format_io does
+		if (os.width() != 0)
+		{
+			legacy::scoped_buffer text{};
+			format_to(text, fs, args...);
+			os << text.view();
+			return;
+		}
+		const std::ostream::sentry ok{os};
+		if (!ok)
+			return;
+		legacy::streambuf_sink sink{os.rdbuf()};
+		format_to(sink, fs, args...);
+		sink.flush();
+		if (!sink.good())
+			os.setstate(std::ios_base::badbit);
+	}
+} // namespace lava::format
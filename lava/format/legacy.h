@@ -1,7 +1,16 @@
 #pragma once
 #include <lava/format/legacy/ansi.h>
 #include <lava/format/legacy/basic.h>
+#include <lava/format/legacy/batch.h>
+#include <lava/format/legacy/buffer.h>
+#include <lava/format/legacy/chrono.h>
+#include <lava/format/legacy/constant.h>
 #include <lava/format/legacy/containers.h>
+#include <lava/format/legacy/floats.h>
 #include <lava/format/legacy/integers.h>
 #include <lava/format/legacy/meta.h>
+#include <lava/format/legacy/sinks.h>
+#include <lava/format/legacy/table.h>
 #include <lava/format/legacy/text.h>
+#include <lava/format/legacy/utf.h>
+#include <lava/format/legacy/vformat.h>
@@ -1,60 +1,204 @@
 #pragma once
 #include "basic.h"
 #include "integers.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#if __has_include(<unistd.h>)
+#	include <unistd.h>
+#elif defined(_WIN32)
+#	include <io.h>
+#endif
 
 namespace lava::format::legacy
 {
 	// Wrapper for ANSI Escape Sequence
-	struct ansi
+	// a set of SGR attributes (bold, faint, ...) plus a foreground and a background colour
+	// the escape sequence is built at compile time, and formatted without allocation
+	class ansi
 	{
-		std::string ansi;
+	public:
+		constexpr ansi() = default;
+
+		// SGR attribute `code` in [0, 9], e.g. 1 for bold
+		template<unsigned code>
+		static constexpr ansi attribute()
+		{
+			static_assert(code <= 9, "lava::format: SGR attributes are in [0, 9], other SGR codes cannot be written.");
+			return ansi{static_cast<unsigned short>(1u << code), 0, 0};
+		}
+		// foreground colour `code`, in [30, 37] or [90, 97]
+		static constexpr ansi foreground(unsigned code) { return ansi{0, static_cast<unsigned char>(code), 0}; }
+		// background colour `code`, in [40, 47] or [100, 107]
+		static constexpr ansi background(unsigned code) { return ansi{0, 0, static_cast<unsigned char>(code)}; }
+
+		// Combine 2 ANSI Escape Sequences, colours on the right hand side take precedence
+		constexpr ansi operator|(const ansi& rhs) const
+		{
+			return ansi{
+				static_cast<unsigned short>(attributes | rhs.attributes),
+				rhs.fg != 0 ? rhs.fg : fg,
+				rhs.bg != 0 ? rhs.bg : bg};
+		}
+		// Combine 2 ANSI Escape Sequences, alias for operator|
+		constexpr ansi operator+(const ansi& rhs) const { return *this | rhs; }
+
+		// the escape sequence, "\033[...m"
+		constexpr std::string_view sequence() const { return {text, length}; }
+
+	private:
+		constexpr ansi(unsigned short attributes, unsigned char fg, unsigned char bg)
+			: attributes{attributes}
+			, fg{fg}
+			, bg{bg}
+		{
+			const auto put = [this](unsigned code) {
+				if (length != 2)
+					text[length++] = ';';
+				if (code >= 100)
+					text[length++] = static_cast<char>('0' + code / 100);
+				if (code >= 10)
+					text[length++] = static_cast<char>('0' + code / 10 % 10);
+				text[length++] = static_cast<char>('0' + code % 10);
+			};
+			text[length++] = '\033';
+			text[length++] = '[';
+			for (unsigned code = 0; code != 10; ++code)
+				if (attributes & (1u << code))
+					put(code);
+			if (fg != 0)
+				put(fg);
+			if (bg != 0)
+				put(bg);
+			text[length++] = 'm';
+		}
+
+		unsigned short attributes{0};
+		unsigned char fg{0};
+		unsigned char bg{0};
+		// "\033[", 10 attributes "0;1;...;9", ";97;107", "m"
+		char text[32]{};
+		unsigned char length{0};
 	};
 
-	// Combine 2 ANSI Escape Sequences
-	inline ansi operator|(const ansi& lhs, const ansi& rhs)
+	inline constexpr ansi Black = ansi::foreground(30);
+	inline constexpr ansi Red = ansi::foreground(31);
+	inline constexpr ansi Green = ansi::foreground(32);
+	inline constexpr ansi Blue = ansi::foreground(34);
+	inline constexpr ansi Yellow = ansi::foreground(33);
+	inline constexpr ansi Cyan = ansi::foreground(36);
+	inline constexpr ansi Magenta = ansi::foreground(35);
+	inline constexpr ansi White = ansi::foreground(37);
+	inline constexpr ansi Black_BRI = ansi::foreground(90);
+	inline constexpr ansi Red_BRI = ansi::foreground(91);
+	inline constexpr ansi Green_BRI = ansi::foreground(92);
+	inline constexpr ansi Blue_BRI = ansi::foreground(94);
+	inline constexpr ansi Yellow_BRI = ansi::foreground(93);
+	inline constexpr ansi Cyan_BRI = ansi::foreground(96);
+	inline constexpr ansi Magenta_BRI = ansi::foreground(95);
+	inline constexpr ansi White_BRI = ansi::foreground(97);
+	inline constexpr ansi Reset = ansi::attribute<0>();
+	inline constexpr ansi Intense = ansi::attribute<1>();
+	inline constexpr ansi Fainted = ansi::attribute<2>();
+
+	inline constexpr ansi ErrorColour = Red_BRI + Intense;
+	inline constexpr ansi WarningColour = Yellow_BRI + Intense;
+	inline constexpr ansi InfoColour = Cyan_BRI + Intense;
+	inline constexpr ansi DebugColour = Blue_BRI + Intense;
+
+	// whether ANSI escape sequences are written
+	enum class colour_policy : unsigned char
 	{
-		return ansi{lhs.ansi + ";" + rhs.ansi};
-	}
+		never,
+		always,
+		automatic // only if the destination is a terminal, and NO_COLOR is not set
+	};
 
-	// Combine 2 ANSI Escape Sequences, alias for operator|
-	inline ansi operator+(const ansi& lhs, const ansi& rhs)
+	namespace detail
 	{
-		return operator|(lhs, rhs);
-	}
+		inline std::atomic<colour_policy> colour_setting{colour_policy::automatic};
 
-	inline const ansi Black{"30"};
-	inline const ansi Red{"31"};
-	inline const ansi Green{"32"};
-	inline const ansi Blue{"34"};
-	inline const ansi Yellow{"33"};
-	inline const ansi Cyan{"36"};
-	inline const ansi Magenta{"35"};
-	inline const ansi White{"37"};
-	inline const ansi Black_BRI{"90"};
-	inline const ansi Red_BRI{"91"};
-	inline const ansi Green_BRI{"92"};
-	inline const ansi Blue_BRI{"94"};
-	inline const ansi Yellow_BRI{"93"};
-	inline const ansi Cyan_BRI{"96"};
-	inline const ansi Magenta_BRI{"95"};
-	inline const ansi White_BRI{"97"};
-	inline const ansi Reset{"0"};
-	inline const ansi Intense{"1"};
-	inline const ansi Fainted{"2"};
-
-	inline const ansi ErrorColour = Red_BRI + Intense;
-	inline const ansi WarningColour = Yellow_BRI + Intense;
-	inline const ansi InfoColour = Cyan_BRI + Intense;
-	inline const ansi DebugColour = Blue_BRI + Intense;
+		// whether NO_COLOR forbids the escape sequences
+		inline bool no_colour() noexcept
+		{
+			const char* no_colour = std::getenv("NO_COLOR");
+			return no_colour != nullptr && no_colour[0] != '\0';
+		}
+
+		// whether the file descriptor `fd` is a terminal, false for -1
+		inline bool is_terminal(int fd) noexcept
+		{
+			if (fd < 0)
+				return false;
+#if __has_include(<unistd.h>)
+			return ::isatty(fd) != 0;
+#elif defined(_WIN32)
+			return ::_isatty(fd) != 0;
+#else
+			return true;
+#endif
+		}
+	} // namespace detail
+
+	// set the policy for ANSI escape sequences, `automatic` by default
+	inline void set_colour_policy(colour_policy p) noexcept { detail::colour_setting.store(p, std::memory_order_relaxed); }
+
+	// whether ANSI escape sequences are written under the current policy
+	// the destination is the stream or file descriptor being written to (see detail::destination_scope),
+	// asked once for each call; text formatted to strings takes stderr, detected once,
+	// for lava messages (see lava.assert) usually go there
+	inline bool colour_enabled() noexcept
+	{
+		switch (detail::colour_setting.load(std::memory_order_relaxed))
+		{
+		case colour_policy::never:
+			return false;
+		case colour_policy::always:
+			return true;
+		default:
+		{
+			static const bool allowed = !detail::no_colour();
+			if (!allowed)
+				return false;
+			if (auto* d = detail::destination_scope::current())
+			{
+				if (d->terminal < 0)
+					d->terminal = detail::is_terminal(d->fd);
+				return d->terminal != 0;
+			}
+#if __has_include(<unistd.h>)
+			static const bool detected = detail::is_terminal(::fileno(stderr));
+#elif defined(_WIN32)
+			static const bool detected = detail::is_terminal(::_fileno(stderr));
+#else
+			static const bool detected = true;
+#endif
+			return detected;
+		}
+		}
+	}
 
 	template<> // format a ANSI colour sequence
 	struct format_trait<ansi>
 	{
-		static void format_append(std::string& res, const ansi& c)
+		template<typename Sink>
+		static void format_append(Sink& res, const ansi& c)
+		{
+			const std::string_view s = view(c);
+			if (!s.empty())
+				res.append(s.data(), s.size());
+		}
+		static constexpr size_t formatted_size(const ansi& c) { return c.sequence().size(); }
+		static std::string_view view(const ansi& c)
 		{
 #ifndef LAVA_DISABLE_ANSI_ESCAPE_SEQUENCE
-			format_s(res, "\033[", c.ansi, 'm');
+			if (colour_enabled())
+				return c.sequence();
 #endif
+			static_cast<void>(c);
+			return {};
 		}
 	};
 
@@ -1,20 +1,119 @@
 ﻿#pragma once
+#include "buffer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 namespace lava::format::legacy
 {
 	// trait format_trait<T>
+	// format_trait<T>::format_append(res, x) appends the formatted `x` to the sink `res`
+	// format_trait<T>::formatted_size(x) (optional) reports an upper bound of its length
+	//
+	// a sink is any object with the 2 member functions below (std::string is a sink):
+	//   void push_back(char c);
+	//   void append(const char* s, size_t n);
+	// traits written for `std::string&` only still work with other sinks (see format_to)
 	template<typename T>
 	struct format_trait;
 
-	inline void format_s(std::string& res) {}
+	// trait has_formatted_size<T>: whether format_trait<T> reports the size of its output
+	template<typename T, typename = void>
+	struct has_formatted_size : std::false_type
+	{};
+	template<typename T>
+	struct has_formatted_size<T, std::void_t<decltype(format_trait<T>::formatted_size(std::declval<const T&>()))>>
+		: std::true_type
+	{};
+
+	// trait has_view<T>: whether format_trait<T> exposes the formatted text as-is
+	// format_trait<T>::view(x) returns a std::string_view of the formatted `x`
+	template<typename T, typename = void>
+	struct has_view : std::false_type
+	{};
+	template<typename T>
+	struct has_view<T, std::void_t<decltype(format_trait<T>::view(std::declval<const T&>()))>>
+		: std::true_type
+	{};
+
+	// trait is_sink_trait<T, Sink>: whether format_trait<T> can append to `Sink` directly
+	template<typename T, typename Sink, typename U = const T&, typename = void>
+	struct is_sink_trait : std::false_type
+	{};
+	template<typename T, typename Sink, typename U>
+	struct is_sink_trait<T, Sink, U, std::void_t<decltype(format_trait<T>::format_append(std::declval<Sink&>(), std::declval<U>()))>>
+		: std::true_type
+	{};
+
+	namespace detail
+	{
+		// the size reported by format_trait<T>, or 0 if there is none
+		template<typename T, typename U>
+		inline size_t formatted_size_of(const U& x)
+		{
+			if constexpr (has_formatted_size<T>::value)
+				return format_trait<T>::formatted_size(x);
+			else
+				return 0;
+		}
+	} // namespace detail
+
+	// formatted_size: an upper bound of the length of all the parameters formatted
+	// parameters with no size reported by their format_trait are counted as 0
+	template<typename... Us>
+	inline size_t formatted_size(const Us&... xs)
+	{
+		return (size_t{0} + ... + detail::formatted_size_of<std::decay_t<Us>>(xs));
+	}
+
+	namespace detail
+	{
+		// make room for `n` more characters in `res`, growing geometrically
+		// so that repeated appends to the same string stay amortized O(1)
+		inline void reserve_append(std::string& res, size_t n)
+		{
+			const size_t required = res.size() + n;
+			if (required > res.capacity())
+				res.reserve(std::max(required, 2 * res.capacity()));
+		}
+
+		// format one parameter to `res`
+		// traits supporting only `std::string&` are adapted through a scratch string
+		template<typename Sink, typename U>
+		inline void format_one(Sink& res, U&& x)
+		{
+			using T = std::decay_t<U>;
+			if constexpr (is_sink_trait<T, Sink, U&&>::value)
+				format_trait<T>::format_append(res, std::forward<U>(x));
+			else
+			{
+				scoped_buffer temp{};
+				format_trait<T>::format_append(temp.str(), std::forward<U>(x));
+				res.append(temp.str().data(), temp.size());
+			}
+		}
+	} // namespace detail
+
+	// format_to: format all the parameters to the sink `res`
+	template<typename Sink, typename... Us>
+	inline void format_to(Sink& res, Us&&... xs)
+	{
+		(detail::format_one(res, std::forward<Us>(xs)), ...);
+	}
+
 	// format_s: format all the parameters to string `res`
-	template<typename U, typename... Us>
-	inline void format_s(std::string& res, U&& x, Us&&... xs)
+	// the space needed is reserved once, before any parameter is formatted
+	template<typename... Us>
+	inline void format_s(std::string& res, Us&&... xs)
 	{
-		format_trait<std::decay_t<U>>::format_append(res, std::forward<U>(x));
-		format_s(res, std::forward<Us>(xs)...);
+		detail::reserve_append(res, formatted_size(xs...));
+		format_to(res, std::forward<Us>(xs)...);
 	}
 
 	// format: format all the parameters, return the result
@@ -26,11 +125,169 @@ namespace lava::format::legacy
 		return res;
 	}
 
+	// format_scoped: format all the parameters to a scratch string of this thread, return it
+	// for intermediate text, no heap allocation is done once the scratch strings are warmed up
+	template<typename... Us>
+	inline scoped_buffer format_scoped(Us&&... args)
+	{
+		scoped_buffer res{};
+		format_s(res.str(), std::forward<Us>(args)...);
+		return res;
+	}
+
+	template<> // format the contents of a scoped buffer
+	struct format_trait<scoped_buffer>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const scoped_buffer& b) { res.append(b.str().data(), b.size()); }
+		static size_t formatted_size(const scoped_buffer& b) { return b.size(); }
+		static std::string_view view(const scoped_buffer& b) { return b.view(); }
+	};
+
+	namespace detail
+	{
+		// the file descriptor the text formatted on this thread is written to, -1 if it is not one
+		// set by the entry points writing to a stream, a C stream or a file descriptor, for the colour policy
+		class destination_scope
+		{
+		public:
+			explicit destination_scope(int fd) noexcept
+				: fd{fd}
+				, previous{std::exchange(current(), this)}
+			{}
+			~destination_scope() { current() = previous; }
+			destination_scope(const destination_scope&) = delete;
+			destination_scope& operator=(const destination_scope&) = delete;
+
+			// the innermost destination of this thread, nullptr when formatting to strings
+			static destination_scope*& current() noexcept
+			{
+				thread_local destination_scope* p = nullptr;
+				return p;
+			}
+
+			const int fd;
+			signed char terminal{-1}; // whether `fd` is a terminal, -1 until asked
+
+		private:
+			destination_scope* const previous;
+		};
+
+		// the file descriptor of the standard streams, -1 for the others (files, strings...)
+		inline int stream_fd(const std::ostream& os) noexcept
+		{
+			const std::streambuf* b = os.rdbuf();
+			if (b == std::cout.rdbuf())
+				return 1;
+			if (b == std::cerr.rdbuf() || b == std::clog.rdbuf())
+				return 2;
+			return -1;
+		}
+
+		// the file descriptor of `file`, -1 where there is none
+		inline int file_fd(std::FILE* file) noexcept
+		{
+#if __has_include(<unistd.h>)
+			return ::fileno(file);
+#elif defined(_WIN32)
+			return ::_fileno(file);
+#else
+			return -1;
+#endif
+		}
+	} // namespace detail
+
+	// a sink gathering text in a fixed stack buffer, handing it to `Writer` in bounded chunks
+	// `Writer` is called as `bool(const char* s, size_t n)`, returning false on failure
+	// pieces larger than the buffer are handed to `Writer` directly, without any copy
+	template<typename Writer, size_t N = 512>
+	class buffered_sink
+	{
+	public:
+		template<typename... Args>
+		explicit buffered_sink(Args&&... args)
+			: writer{std::forward<Args>(args)...}
+		{}
+		~buffered_sink() { flush(); }
+		buffered_sink(const buffered_sink&) = delete;
+		buffered_sink& operator=(const buffered_sink&) = delete;
+
+		void push_back(char c)
+		{
+			if (used == N)
+				flush();
+			buffer[used++] = c;
+		}
+		void append(const char* s, size_t n)
+		{
+			if (n > N - used)
+			{
+				flush();
+				if (n >= N)
+				{
+					write(s, n);
+					return;
+				}
+			}
+			std::memcpy(buffer + used, s, n);
+			used += n;
+		}
+		// hand the buffered text to the writer
+		void flush()
+		{
+			if (used != 0)
+				write(buffer, used);
+			used = 0;
+		}
+		// whether all the writes so far succeeded
+		bool good() const noexcept { return ok; }
+
+	private:
+		void write(const char* s, size_t n)
+		{
+			if (ok)
+				ok = writer(s, n);
+		}
+
+		Writer writer;
+		bool ok{true};
+		size_t used{0};
+		char buffer[N];
+	};
+
+	// writer for buffered_sink: a std::streambuf
+	struct streambuf_writer
+	{
+		std::streambuf* buf;
+		bool operator()(const char* s, size_t n) const
+		{
+			const auto sn = static_cast<std::streamsize>(n);
+			return buf->sputn(s, sn) == sn;
+		}
+	};
+	// sink: the stream buffer of a std::ostream
+	using streambuf_sink = buffered_sink<streambuf_writer>;
+
 	// format_io: format all the parameters to output stream `os`
+	// the text is streamed to `os.rdbuf()` piece by piece, without building the whole string
 	template<typename... Us>
 	inline void format_io(std::ostream& os, Us&&... xs)
 	{
-		os << format(std::forward<Us>(xs)...);
+		const detail::destination_scope destination{detail::stream_fd(os)};
+		// a field width applies to the whole text, so it has to be built first
+		if (os.width() != 0)
+		{
+			os << format_scoped(std::forward<Us>(xs)...).view();
+			return;
+		}
+		const std::ostream::sentry ok{os};
+		if (!ok)
+			return;
+		streambuf_sink sink{os.rdbuf()};
+		format_to(sink, std::forward<Us>(xs)...);
+		sink.flush();
+		if (!sink.good())
+			os.setstate(std::ios_base::badbit);
 	}
 
 	// an example for supporting new types in lava.format
@@ -41,6 +298,8 @@ namespace lava::format::legacy
 	template<>
 	struct format_trait<endl_t>
 	{
-		static void format_append(std::string& res, endl_t) { res.push_back('\n'); }
+		template<typename Sink>
+		static void format_append(Sink& res, endl_t) { res.push_back('\n'); }
+		static constexpr size_t formatted_size(endl_t) { return 1; }
 	};
 } // namespace lava::format::legacy
@@ -0,0 +1,208 @@
+#pragma once
+#include "basic.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace lava::format::legacy
+{
+	namespace detail
+	{
+		// the default formatter for format_batch: the element as-is
+		struct format_element
+		{
+			template<typename Sink, typename T>
+			void operator()(Sink& res, const T& x) const { format_to(res, x); }
+		};
+
+		// the count of chunks a batch of `n` elements is split into
+		inline size_t batch_chunks(size_t n, unsigned threads) noexcept
+		{
+			// fewer elements are not worth a thread
+			constexpr size_t min_chunk = 1024;
+			if (threads == 0)
+				threads = std::max(std::thread::hardware_concurrency(), 1u);
+			return std::max<size_t>(1, std::min<size_t>(threads, n / min_chunk));
+		}
+
+		// a barrier for the threads of parallel_phases, whose count is only known once they are started
+		class phase_barrier
+		{
+		public:
+			// the count of threads arriving, set before the calling thread arrives
+			void expect(size_t n)
+			{
+				const std::lock_guard<std::mutex> lock{mutex};
+				expected = n;
+			}
+			// wait for all the threads, the last one arriving runs `f` first
+			template<typename F>
+			void arrive_and_wait(F&& f)
+			{
+				std::unique_lock<std::mutex> lock{mutex};
+				if (++arrived == expected)
+				{
+					f();
+					open = true;
+					opened.notify_all();
+				}
+				else
+					opened.wait(lock, [this] { return open; });
+			}
+
+		private:
+			std::mutex mutex;
+			std::condition_variable opened;
+			size_t arrived{0};
+			size_t expected{SIZE_MAX};
+			bool open{false};
+		};
+
+		// run `first(k)` then `second(k)` for each k in [0, n), each k on its own thread, the calling thread taking k = 0
+		// `between()` runs once, after all the calls of `first` and before any call of `second`
+		// the values of k whose thread cannot be started run on the calling thread
+		// the first exception thrown is rethrown after all the threads are joined, and skips `second`
+		template<typename First, typename Between, typename Second>
+		inline void parallel_phases(size_t n, First&& first, Between&& between, Second&& second)
+		{
+			std::vector<std::exception_ptr> errors(n + 1);
+			const auto guarded = [&errors](size_t k, auto&& f) {
+				try
+				{
+					f();
+				}
+				catch (...)
+				{
+					errors[k] = std::current_exception();
+				}
+			};
+			phase_barrier barrier;
+			bool failed = false;
+			const auto sync = [&] {
+				barrier.arrive_and_wait([&] {
+					guarded(n, between);
+					failed = std::any_of(errors.begin(), errors.end(), [](const auto& e) { return e != nullptr; });
+				});
+			};
+			const auto run = [&](size_t k) {
+				guarded(k, [&] { first(k); });
+				sync();
+				if (!failed)
+					guarded(k, [&] { second(k); });
+			};
+
+			std::vector<std::thread> workers;
+			workers.reserve(n);
+			size_t started = 1;
+			try
+			{
+				for (; started < n; ++started)
+					workers.emplace_back(run, started);
+			}
+			catch (const std::system_error&)
+			{
+				// out of threads: the calling thread takes the rest
+			}
+			barrier.expect(workers.size() + 1);
+			for (size_t k = 0; k < n; k = k == 0 ? started : k + 1)
+				guarded(k, [&] { first(k); });
+			sync();
+			if (!failed)
+				for (size_t k = 0; k < n; k = k == 0 ? started : k + 1)
+					guarded(k, [&] { second(k); });
+			for (auto& w : workers)
+				w.join();
+			for (auto& e : errors)
+				if (e)
+					std::rethrow_exception(e);
+		}
+
+		// run `f(k)` for each k in [0, n), see parallel_phases
+		template<typename F>
+		inline void parallel_for(size_t n, F&& f)
+		{
+			parallel_phases(n, f, [] {}, [](size_t) {});
+		}
+
+		// format the elements [first, last) of `range` to `res`
+		template<typename Range, typename Formatter>
+		inline void format_chunk(std::string& res, const Range& range, const Formatter& f, size_t first, size_t last)
+		{
+			auto p = std::next(std::cbegin(range), static_cast<std::ptrdiff_t>(first));
+			const auto pend = std::next(std::cbegin(range), static_cast<std::ptrdiff_t>(last));
+			for (; p != pend; ++p)
+				f(res, *p);
+		}
+
+		// format the elements of `range` to one buffer per chunk, in parallel
+		template<typename Range, typename Formatter>
+		inline std::vector<std::string> format_chunks(const Range& range, const Formatter& f, size_t chunks)
+		{
+			const size_t n = std::size(range);
+			std::vector<std::string> buffers(chunks);
+			parallel_for(chunks, [&](size_t k) { format_chunk(buffers[k], range, f, n * k / chunks, n * (k + 1) / chunks); });
+			return buffers;
+		}
+	} // namespace detail
+
+	// format_batch_to: format each element `x` of `range` as `f(res, x)` to the sink `res`
+	// `f` is called with a `std::string&`, e.g. [](auto& res, const auto& x) { format_to(res, x, endl); }
+	// the range is split into chunks formatted on up to `threads` threads (0 for all the cores),
+	// each to its own buffer, and the buffers are appended in order
+	// `range` needs std::size, and is best with random access iterators
+	template<typename Sink, typename Range, typename Formatter = detail::format_element>
+	inline void format_batch_to(Sink& res, const Range& range, const Formatter& f = {}, unsigned threads = 0)
+	{
+		const size_t chunks = detail::batch_chunks(std::size(range), threads);
+		if constexpr (std::is_same_v<Sink, std::string>)
+			if (chunks == 1)
+			{
+				for (const auto& x : range)
+					f(res, x);
+				return;
+			}
+		for (const auto& buffer : detail::format_chunks(range, f, chunks))
+			res.append(buffer.data(), buffer.size());
+	}
+
+	// format_batch: format each element `x` of `range` as `f(res, x)`, return the result
+	// the chunks are gathered to one string, each copied to its offset in parallel by the thread formatting it
+	template<typename Range, typename Formatter = detail::format_element>
+	inline std::string format_batch(const Range& range, const Formatter& f = {}, unsigned threads = 0)
+	{
+		std::string res{};
+		const size_t chunks = detail::batch_chunks(std::size(range), threads);
+		if (chunks == 1)
+		{
+			for (const auto& x : range)
+				f(res, x);
+			return res;
+		}
+		// the same threads format the chunks, then copy them to their offsets once all are done
+		const size_t n = std::size(range);
+		std::vector<std::string> buffers(chunks);
+		std::vector<size_t> offsets(chunks + 1);
+		detail::parallel_phases(
+			chunks,
+			[&](size_t k) { detail::format_chunk(buffers[k], range, f, n * k / chunks, n * (k + 1) / chunks); },
+			[&] {
+				// prefix sum: the offset of each chunk in the result
+				for (size_t k = 0; k != chunks; ++k)
+					offsets[k + 1] = offsets[k] + buffers[k].size();
+				res.resize(offsets[chunks]);
+			},
+			[&](size_t k) {
+				if (!buffers[k].empty())
+					std::memcpy(res.data() + offsets[k], buffers[k].data(), buffers[k].size());
+			});
+		return res;
+	}
+} // namespace lava::format::legacy
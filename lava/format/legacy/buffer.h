@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace lava::format::legacy
+{
+	namespace detail
+	{
+		// scratch strings of this thread, kept with their capacity between uses
+		class buffer_pool
+		{
+		public:
+			// strings kept at most, and the largest capacity kept
+			static constexpr size_t max_count = 16;
+			static constexpr size_t max_capacity = 64 * 1024;
+
+			std::string acquire() noexcept
+			{
+				if (count == 0)
+					return {};
+				return std::move(free[--count]);
+			}
+			// a fixed array of slots: giving a string back never allocates, nor throws
+			void release(std::string&& s) noexcept
+			{
+				// a string too large would pin its memory for the life of the thread
+				if (count == max_count || s.capacity() > max_capacity)
+					return;
+				s.clear();
+				free[count++] = std::move(s);
+			}
+
+		private:
+			std::string free[max_count];
+			size_t count{0};
+		};
+
+		inline buffer_pool& local_buffers()
+		{
+			thread_local buffer_pool pool;
+			return pool;
+		}
+	} // namespace detail
+
+	// a scratch string borrowed from a pool of this thread, and given back on destruction
+	// once warmed up, formatting to scoped buffers does no heap allocation
+	// scoped_buffer is a sink, and it can be formatted as its contents
+	class scoped_buffer
+	{
+	public:
+		scoped_buffer()
+			: buffer{detail::local_buffers().acquire()}
+		{}
+		~scoped_buffer()
+		{
+			if (owner)
+				detail::local_buffers().release(std::move(buffer));
+		}
+		scoped_buffer(scoped_buffer&& rhs) noexcept
+			: buffer{std::move(rhs.buffer)}
+			, owner{std::exchange(rhs.owner, false)}
+		{}
+		scoped_buffer(const scoped_buffer&) = delete;
+		scoped_buffer& operator=(const scoped_buffer&) = delete;
+		scoped_buffer& operator=(scoped_buffer&&) = delete;
+
+		void push_back(char c) { buffer.push_back(c); }
+		void append(const char* s, size_t n) { buffer.append(s, n); }
+
+		std::string& str() noexcept { return buffer; }
+		const std::string& str() const noexcept { return buffer; }
+		std::string_view view() const noexcept { return buffer; }
+		operator std::string_view() const noexcept { return buffer; }
+		const char* c_str() const noexcept { return buffer.c_str(); }
+		size_t size() const noexcept { return buffer.size(); }
+
+	private:
+		std::string buffer;
+		bool owner{true};
+	};
+} // namespace lava::format::legacy
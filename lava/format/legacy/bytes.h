@@ -0,0 +1,375 @@
+#pragma once
+#include "basic.h"
+#include "escape.h"
+#include "integers.h"
+#include <lava/ascii.h>
+#include <iterator>
+#include <string>
+#include <type_traits>
+
+#if defined(LAVA_FORMAT_HAS_AVX2)
+#	define LAVA_FORMAT_HAS_SSSE3
+#endif
+
+// byte buffers formatted in bulk: hexadecimal, base64 and the classic hex dump
+// not included by <lava/format/legacy.h>, for lava.ascii depends on lava.assert, which depends on lava.format
+namespace lava::format::legacy
+{
+	// a view of bytes, from a pointer and a size, or any contiguous container of bytes
+	struct byte_span
+	{
+		const unsigned char* data;
+		size_t size;
+
+		byte_span(const void* p, size_t n)
+			: data{static_cast<const unsigned char*>(p)}
+			, size{n}
+		{}
+		template<typename C, typename = std::enable_if_t<sizeof(*std::data(std::declval<const C&>())) == 1>>
+		byte_span(const C& c)
+			: byte_span{std::data(c), std::size(c)}
+		{}
+		// a string literal, without its terminating NUL
+		template<size_t N>
+		byte_span(const char (&s)[N])
+			: byte_span{s, N - 1}
+		{}
+	};
+
+	template<bool capital = true>
+	struct hex_bytes // format bytes as hexadecimal digits, 2 for each byte
+	{
+		byte_span bytes;
+	};
+	template<bool capital = true>
+	inline hex_bytes<capital> hex(byte_span s)
+	{
+		return {s};
+	}
+	template<bool capital = true>
+	inline hex_bytes<capital> hex(const void* p, size_t n)
+	{
+		return {{p, n}};
+	}
+
+	struct base64_bytes // format bytes in base64 (RFC 4648), padded with '='
+	{
+		byte_span bytes;
+	};
+	inline base64_bytes base64(byte_span s) { return {s}; }
+	inline base64_bytes base64(const void* p, size_t n) { return {{p, n}}; }
+
+	template<bool capital = true>
+	struct hexdump_bytes // format bytes as lines of an offset, 16 bytes in hexadecimal and as ASCII
+	{
+		byte_span bytes;
+		size_t offset; // the offset shown for the first byte
+	};
+	template<bool capital = true>
+	inline hexdump_bytes<capital> hexdump(byte_span s, size_t offset = 0)
+	{
+		return {s, offset};
+	}
+	template<bool capital = true>
+	inline hexdump_bytes<capital> hexdump(const void* p, size_t n, size_t offset = 0)
+	{
+		return {{p, n}, offset};
+	}
+
+	namespace detail
+	{
+		// write the 2 hexadecimal digits of each byte in [s, s + n) to `out`
+		template<bool capital>
+		inline char* encode_hex_scalar(const unsigned char* s, size_t n, char* out) noexcept
+		{
+			constexpr auto& pairs = hexadecimal_pairs<capital>;
+			for (size_t i = 0; i != n; ++i, out += 2)
+			{
+				out[0] = pairs[2 * s[i]];
+				out[1] = pairs[2 * s[i] + 1];
+			}
+			return out;
+		}
+
+#ifdef LAVA_FORMAT_HAS_SSE2
+		// 16 bytes at a time: split the nibbles, interleave them, then map 0-15 to the digits
+		template<bool capital>
+		inline char* encode_hex_sse2(const unsigned char* s, size_t n, char* out) noexcept
+		{
+			const __m128i mask = _mm_set1_epi8(0x0F), nine = _mm_set1_epi8(9);
+			const __m128i zero = _mm_set1_epi8('0'), letter = _mm_set1_epi8(capital ? 'A' - '0' - 10 : 'a' - '0' - 10);
+			const auto digits = [&](__m128i x) {
+				return _mm_add_epi8(_mm_add_epi8(x, zero), _mm_and_si128(_mm_cmpgt_epi8(x, nine), letter));
+			};
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16, out += 32)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+				const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask), lo = _mm_and_si128(v, mask);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), digits(_mm_unpacklo_epi8(hi, lo)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), digits(_mm_unpackhi_epi8(hi, lo)));
+			}
+			return encode_hex_scalar<capital>(s + i, n - i, out);
+		}
+#endif
+
+#ifdef LAVA_FORMAT_HAS_AVX2
+		// 32 bytes at a time, only called if the processor supports AVX2
+		template<bool capital>
+		__attribute__((target("avx2"))) inline char* encode_hex_avx2(const unsigned char* s, size_t n, char* out) noexcept
+		{
+			const __m256i mask = _mm256_set1_epi8(0x0F), nine = _mm256_set1_epi8(9);
+			const __m256i zero = _mm256_set1_epi8('0'), letter = _mm256_set1_epi8(capital ? 'A' - '0' - 10 : 'a' - '0' - 10);
+			size_t i = 0;
+			for (; i + 32 <= n; i += 32, out += 64)
+			{
+				const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+				const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), mask), lo = _mm256_and_si256(v, mask);
+				// unpacking works within 128-bit lanes: bytes 0-7 and 16-23, then 8-15 and 24-31
+				__m256i a = _mm256_unpacklo_epi8(hi, lo), b = _mm256_unpackhi_epi8(hi, lo);
+				a = _mm256_add_epi8(_mm256_add_epi8(a, zero), _mm256_and_si256(_mm256_cmpgt_epi8(a, nine), letter));
+				b = _mm256_add_epi8(_mm256_add_epi8(b, zero), _mm256_and_si256(_mm256_cmpgt_epi8(b, nine), letter));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permute2x128_si256(a, b, 0x20));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32), _mm256_permute2x128_si256(a, b, 0x31));
+			}
+			return encode_hex_sse2<capital>(s + i, n - i, out);
+		}
+#endif
+
+		using encode_t = char* (*)(const unsigned char*, size_t, char*) noexcept;
+
+		template<bool capital>
+		inline char* encode_hex(const unsigned char* s, size_t n, char* out) noexcept
+		{
+#ifdef LAVA_FORMAT_HAS_AVX2
+			static const encode_t encode = __builtin_cpu_supports("avx2") ? encode_hex_avx2<capital> : encode_hex_sse2<capital>;
+			return encode(s, n, out);
+#elif defined(LAVA_FORMAT_HAS_SSE2)
+			return encode_hex_sse2<capital>(s, n, out);
+#else
+			return encode_hex_scalar<capital>(s, n, out);
+#endif
+		}
+
+		inline constexpr const char* base64_digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		// base64 of the bytes in [s, s + n), padded if n is not a multiple of 3
+		inline char* encode_base64_scalar(const unsigned char* s, size_t n, char* out) noexcept
+		{
+			size_t i = 0;
+			for (; i + 3 <= n; i += 3, out += 4)
+			{
+				const unsigned x = unsigned{s[i]} << 16 | unsigned{s[i + 1]} << 8 | s[i + 2];
+				out[0] = base64_digits[x >> 18];
+				out[1] = base64_digits[x >> 12 & 0x3F];
+				out[2] = base64_digits[x >> 6 & 0x3F];
+				out[3] = base64_digits[x & 0x3F];
+			}
+			if (i != n)
+			{
+				const unsigned x = unsigned{s[i]} << 16 | (i + 1 != n ? unsigned{s[i + 1]} << 8 : 0u);
+				out[0] = base64_digits[x >> 18];
+				out[1] = base64_digits[x >> 12 & 0x3F];
+				out[2] = i + 1 != n ? base64_digits[x >> 6 & 0x3F] : '=';
+				out[3] = '=';
+				out += 4;
+			}
+			return out;
+		}
+
+#ifdef LAVA_FORMAT_HAS_SSSE3
+		// 12 bytes to 16 characters, as described by Wojciech Muła
+		// the 4 6-bit indices of each 3 bytes are moved to the 4 bytes of a 32-bit lane with multiplies,
+		// then each index is mapped to its character by adding an offset looked up by range
+		__attribute__((target("ssse3"))) inline __m128i base64_lane(__m128i in) noexcept
+		{
+			in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+			const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+			const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+			const __m128i indices = _mm_or_si128(t0, t1);
+			// 0-25: 'A', 26-51: 'a', 52-61: '0', 62: '+', 63: '/'
+			__m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+			range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+			const __m128i offsets = _mm_setr_epi8(
+				'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+				'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+			return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+		}
+
+		// 12 bytes at a time, reading 16, only called if the processor supports SSSE3
+		__attribute__((target("ssse3"))) inline char* encode_base64_ssse3(const unsigned char* s, size_t n, char* out) noexcept
+		{
+			size_t i = 0;
+			for (; i + 16 <= n; i += 12, out += 16)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64_lane(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i))));
+			return encode_base64_scalar(s + i, n - i, out);
+		}
+#endif
+
+#ifdef LAVA_FORMAT_HAS_AVX2
+		// 24 bytes at a time, reading 28, only called if the processor supports AVX2
+		__attribute__((target("avx2"))) inline char* encode_base64_avx2(const unsigned char* s, size_t n, char* out) noexcept
+		{
+			const __m256i shuffle = _mm256_setr_epi8(
+				1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+				1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+			const __m256i offsets = _mm256_setr_epi8(
+				'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+				'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+				'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+				'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+			size_t i = 0;
+			for (; i + 28 <= n; i += 24, out += 32)
+			{
+				// bytes 0-11 to the low lane, 12-23 to the high lane
+				__m256i in = _mm256_inserti128_si256(
+					_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i))),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 12)), 1);
+				in = _mm256_shuffle_epi8(in, shuffle);
+				const __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+				const __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+				const __m256i indices = _mm256_or_si256(t0, t1);
+				__m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+				range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range)));
+			}
+			return encode_base64_ssse3(s + i, n - i, out);
+		}
+#endif
+
+		// the best implementation for the processor running the program
+		inline encode_t select_encode_base64() noexcept
+		{
+#ifdef LAVA_FORMAT_HAS_AVX2
+			if (__builtin_cpu_supports("avx2"))
+				return encode_base64_avx2;
+#endif
+#ifdef LAVA_FORMAT_HAS_SSSE3
+			if (__builtin_cpu_supports("ssse3"))
+				return encode_base64_ssse3;
+#endif
+			return encode_base64_scalar;
+		}
+
+		inline char* encode_base64(const unsigned char* s, size_t n, char* out) noexcept
+		{
+			static const encode_t encode = select_encode_base64();
+			return encode(s, n, out);
+		}
+
+		// append the encoding of `bytes` to `res`, each `unit` bytes encoded to at most `width` characters
+		// a string is encoded in place, other sinks through a stack buffer, a chunk at a time
+		template<size_t unit, size_t width, typename Sink>
+		inline void append_encoded(Sink& res, byte_span bytes, size_t size, encode_t encode)
+		{
+			if constexpr (std::is_same_v<Sink, std::string>)
+			{
+				const size_t start = res.size();
+				reserve_append(res, size);
+				res.resize(start + size);
+				encode(bytes.data, bytes.size, res.data() + start);
+			}
+			else
+			{
+				constexpr size_t chunk = 1024 * unit;
+				char buffer[1024 * width];
+				for (size_t i = 0; i < bytes.size; i += chunk)
+				{
+					const size_t n = std::min(chunk, bytes.size - i);
+					res.append(buffer, static_cast<size_t>(encode(bytes.data + i, n, buffer) - buffer));
+				}
+			}
+		}
+
+		// the length of a line of hex dump: offset, 16 bytes in 2 groups, and the ASCII column
+		// "00000000  00 01 02 03 04 05 06 07  08 09 0A 0B 0C 0D 0E 0F  |0123456789ABCDEF|\n"
+		constexpr size_t hexdump_line = 8 + 2 + 16 * 3 + 1 + 1 + 1 + 16 + 1 + 1;
+
+		// write a line for the `n` bytes (at most 16) at `s`, return its end
+		template<bool capital>
+		inline char* hexdump_row(const unsigned char* s, size_t n, size_t offset, char* out) noexcept
+		{
+			constexpr auto& pairs = hexadecimal_pairs<capital>;
+			for (int k = 3; k >= 0; --k, out += 2)
+			{
+				const size_t b = (offset >> (8 * k)) & 0xFF;
+				out[0] = pairs[2 * b];
+				out[1] = pairs[2 * b + 1];
+			}
+			*out++ = ' ';
+			for (size_t i = 0; i != 16; ++i)
+			{
+				*out++ = ' ';
+				if (i == 8)
+					*out++ = ' ';
+				out[0] = i < n ? pairs[2 * s[i]] : ' ';
+				out[1] = i < n ? pairs[2 * s[i] + 1] : ' ';
+				out += 2;
+			}
+			*out++ = ' ';
+			*out++ = ' ';
+			*out++ = '|';
+			for (size_t i = 0; i != n; ++i)
+				*out++ = ascii::isprint(static_cast<char>(s[i])) ? static_cast<char>(s[i]) : '.';
+			*out++ = '|';
+			*out++ = '\n';
+			return out;
+		}
+	} // namespace detail
+
+	template<bool capital> // format bytes as hexadecimal digits
+	struct format_trait<hex_bytes<capital>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const hex_bytes<capital>& h)
+		{
+			detail::append_encoded<1, 2>(res, h.bytes, formatted_size(h), detail::encode_hex<capital>);
+		}
+		static size_t formatted_size(const hex_bytes<capital>& h) { return 2 * h.bytes.size; }
+	};
+
+	template<> // format bytes in base64
+	struct format_trait<base64_bytes>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const base64_bytes& b)
+		{
+			detail::append_encoded<3, 4>(res, b.bytes, formatted_size(b), detail::encode_base64);
+		}
+		static size_t formatted_size(const base64_bytes& b) { return (b.bytes.size + 2) / 3 * 4; }
+	};
+
+	template<bool capital> // format bytes as a hex dump
+	struct format_trait<hexdump_bytes<capital>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const hexdump_bytes<capital>& d)
+		{
+			const auto [s, n] = d.bytes;
+			if constexpr (std::is_same_v<Sink, std::string>)
+			{
+				// written in place, then trimmed: the last line may be shorter
+				const size_t start = res.size();
+				detail::reserve_append(res, formatted_size(d));
+				res.resize(start + formatted_size(d));
+				char* out = res.data() + start;
+				for (size_t i = 0; i < n; i += 16)
+					out = detail::hexdump_row<capital>(s + i, std::min<size_t>(16, n - i), d.offset + i, out);
+				res.resize(static_cast<size_t>(out - res.data()));
+			}
+			else
+			{
+				// 64 lines at a time
+				char buffer[64 * detail::hexdump_line];
+				for (size_t i = 0; i < n; i += 64 * 16)
+				{
+					char* out = buffer;
+					for (size_t j = i; j < n && j < i + 64 * 16; j += 16)
+						out = detail::hexdump_row<capital>(s + j, std::min<size_t>(16, n - j), d.offset + j, out);
+					res.append(buffer, static_cast<size_t>(out - buffer));
+				}
+			}
+		}
+		static size_t formatted_size(const hexdump_bytes<capital>& d) { return (d.bytes.size + 15) / 16 * detail::hexdump_line; }
+	};
+} // namespace lava::format::legacy
@@ -0,0 +1,268 @@
+#pragma once
+#include "basic.h"
+#include "floats.h"
+#include "integers.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <ratio>
+#include <string_view>
+#include <type_traits>
+
+namespace lava::format::legacy
+{
+	// a time point written in the local time zone, see `local_time`
+	// time points of std::chrono::system_clock are written in UTC otherwise
+	template<typename Duration>
+	struct local_time_t
+	{
+		std::chrono::time_point<std::chrono::system_clock, Duration> time;
+	};
+	template<typename Duration>
+	inline local_time_t<Duration> local_time(std::chrono::time_point<std::chrono::system_clock, Duration> t) noexcept
+	{
+		return {t};
+	}
+
+	namespace detail
+	{
+		// "YYYY-MM-DD hh:mm:ss", the date and the second of a time point
+		constexpr size_t second_length = 19;
+
+		// the count of digits after the second for a `Duration`, 0 to 9
+		// floating-point counts may hold any fraction: they get all 9 digits
+		template<typename Duration>
+		constexpr int fraction_digits() noexcept
+		{
+			if constexpr (std::is_floating_point_v<typename Duration::rep>)
+				return 9;
+			int n = 0;
+			for (std::intmax_t den = Duration::period::den / Duration::period::num; den > 1 && n < 9; den /= 10)
+				++n;
+			return n;
+		}
+
+		// the year, month and day of the day `z` counted from 1970-01-01, proleptic Gregorian
+		// see http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+		constexpr void civil_from_days(std::int64_t z, std::int64_t& y, unsigned& m, unsigned& d) noexcept
+		{
+			z += 719468;
+			const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+			const auto doe = static_cast<unsigned>(z - era * 146097);
+			const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+			const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+			const unsigned mp = (5 * doy + 2) / 153;
+			d = doy - (153 * mp + 2) / 5 + 1;
+			m = mp < 10 ? mp + 3 : mp - 9;
+			y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+		}
+
+		inline void write_2_digits(char* out, unsigned x) noexcept
+		{
+			out[0] = decimal_pairs[2 * x];
+			out[1] = decimal_pairs[2 * x + 1];
+		}
+
+		// the longest text of a second: a year of 64 bits with its sign
+		constexpr size_t max_second_length = second_length - 4 + 20;
+
+		// write "YYYY-MM-DD hh:mm:ss", return its length
+		// years out of [0, 9999] are written in full, e.g. "-0001" or "12345", as ISO 8601 expanded years
+		inline size_t write_civil(char* out, std::int64_t y, unsigned mo, unsigned d, unsigned h, unsigned mi, unsigned s) noexcept
+		{
+			size_t n = 4;
+			if (0 <= y && y <= 9999)
+			{
+				const auto year = static_cast<unsigned>(y);
+				write_2_digits(out, year / 100);
+				write_2_digits(out + 2, year % 100);
+			}
+			else
+			{
+				const bool negative = y < 0;
+				const auto year = negative ? 0 - static_cast<std::uint64_t>(y) : static_cast<std::uint64_t>(y);
+				const int digits = std::max(count_decimal_digits(year), 4);
+				out[0] = '-';
+				std::memset(out + negative, '0', static_cast<size_t>(digits));
+				write_decimal(out + negative + digits, year);
+				n = negative + static_cast<size_t>(digits);
+			}
+			out += n;
+			out[0] = '-';
+			write_2_digits(out + 1, mo);
+			out[3] = '-';
+			write_2_digits(out + 4, d);
+			out[6] = ' ';
+			write_2_digits(out + 7, h);
+			out[9] = ':';
+			write_2_digits(out + 10, mi);
+			out[12] = ':';
+			write_2_digits(out + 13, s);
+			return n + 15;
+		}
+
+		// the date and the second last written on this thread, rendered once for each second
+		struct second_cache
+		{
+			std::int64_t second{INT64_MIN};
+			size_t length{0};
+			char text[max_second_length]{};
+		};
+
+		// the text of `second`, counted from the epoch, in UTC
+		inline const second_cache& utc_second(std::int64_t second) noexcept
+		{
+			thread_local second_cache cache;
+			if (cache.second != second)
+			{
+				const std::int64_t days = (second >= 0 ? second : second - 86399) / 86400;
+				const auto t = static_cast<unsigned>(second - days * 86400);
+				std::int64_t y = 0;
+				unsigned m = 0, d = 0;
+				civil_from_days(days, y, m, d);
+				cache.length = write_civil(cache.text, y, m, d, t / 3600, t / 60 % 60, t % 60);
+				cache.second = second;
+			}
+			return cache;
+		}
+
+		// the text of `second`, counted from the epoch, in the local time zone
+		inline const second_cache& local_second(std::int64_t second) noexcept
+		{
+			thread_local second_cache cache;
+			if (cache.second != second)
+			{
+				const auto t = static_cast<std::time_t>(second);
+				std::tm tm{};
+#ifdef _WIN32
+				localtime_s(&tm, &t);
+#else
+				localtime_r(&t, &tm);
+#endif
+				cache.length = write_civil(
+					cache.text, tm.tm_year + std::int64_t{1900}, static_cast<unsigned>(tm.tm_mon + 1), static_cast<unsigned>(tm.tm_mday),
+					static_cast<unsigned>(tm.tm_hour), static_cast<unsigned>(tm.tm_min), static_cast<unsigned>(tm.tm_sec));
+				cache.second = second;
+			}
+			return cache;
+		}
+
+		// write a time point of system_clock: the cached date and second, then the digits after the second
+		template<typename Sink, typename Duration>
+		inline void format_time_point(Sink& res, std::chrono::time_point<std::chrono::system_clock, Duration> t, bool local)
+		{
+			using namespace std::chrono;
+			constexpr int digits = fraction_digits<Duration>();
+			const auto since_epoch = t.time_since_epoch();
+			auto second = duration_cast<seconds>(since_epoch);
+			if (second > since_epoch)
+				--second;
+			const second_cache& cache = local ? local_second(second.count()) : utc_second(second.count());
+			const size_t length = cache.length;
+			char buffer[max_second_length + 10];
+			std::memcpy(buffer, cache.text, length);
+			if constexpr (digits == 0)
+				res.append(buffer, length);
+			else
+			{
+				constexpr std::int64_t scale = [] {
+					std::int64_t x = 1;
+					for (int i = 0; i != digits; ++i)
+						x *= 10;
+					return x;
+				}();
+				// floating-point counts round down, and below a whole second
+				const auto sub = std::min<std::int64_t>(
+					scale - 1, std::max<std::int64_t>(0, floor<duration<std::int64_t, std::ratio<1, scale>>>(since_epoch - second).count()));
+				char* end = buffer + length + 1 + digits;
+				buffer[length] = '.';
+				std::memset(buffer + length + 1, '0', digits);
+				write_decimal(end, static_cast<std::uint64_t>(sub));
+				res.append(buffer, length + 1 + digits);
+			}
+		}
+
+		// the suffix of durations of `Period`, empty if there is none
+		template<typename Period>
+		constexpr std::string_view duration_suffix() noexcept
+		{
+			if constexpr (std::is_same_v<Period, std::nano>)
+				return "ns";
+			else if constexpr (std::is_same_v<Period, std::micro>)
+				return "us";
+			else if constexpr (std::is_same_v<Period, std::milli>)
+				return "ms";
+			else if constexpr (std::is_same_v<Period, std::ratio<1>>)
+				return "s";
+			else if constexpr (std::is_same_v<Period, std::ratio<60>>)
+				return "min";
+			else if constexpr (std::is_same_v<Period, std::ratio<3600>>)
+				return "h";
+			else if constexpr (std::is_same_v<Period, std::ratio<86400>>)
+				return "d";
+			else
+				return {};
+		}
+	} // namespace detail
+
+	template<typename Duration> // format a time point of system_clock in UTC, "YYYY-MM-DD hh:mm:ss.fff..."
+	struct format_trait<std::chrono::time_point<std::chrono::system_clock, Duration>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, std::chrono::time_point<std::chrono::system_clock, Duration> t)
+		{
+			detail::format_time_point(res, t, false);
+		}
+		static constexpr size_t max_length = detail::max_second_length + 10;
+		static constexpr size_t formatted_size(std::chrono::time_point<std::chrono::system_clock, Duration>) { return max_length; }
+	};
+
+	template<typename Duration> // format a time point of system_clock in the local time zone
+	struct format_trait<local_time_t<Duration>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, local_time_t<Duration> t) { detail::format_time_point(res, t.time, true); }
+		static constexpr size_t max_length = detail::max_second_length + 10;
+		static constexpr size_t formatted_size(local_time_t<Duration>) { return max_length; }
+	};
+
+	template<typename Rep, typename Period> // format a duration: its count and its unit, e.g. "15ms"
+	struct format_trait<std::chrono::duration<Rep, Period>>
+	{
+		using U = std::chrono::duration<Rep, Period>;
+		template<typename Sink>
+		static void format_append(Sink& res, U d)
+		{
+			if constexpr (std::is_floating_point_v<Rep>)
+				detail::format_one(res, d.count());
+			else
+				detail::format_one(res, decimal(d.count()));
+			constexpr std::string_view suffix = detail::duration_suffix<Period>();
+			if constexpr (!suffix.empty())
+				res.append(suffix.data(), suffix.size());
+			else
+			{
+				// the unit as a fraction of a second, e.g. "[1/30]s"
+				res.push_back('[');
+				detail::format_one(res, decimal(Period::num));
+				if constexpr (Period::den != 1)
+				{
+					res.push_back('/');
+					detail::format_one(res, decimal(Period::den));
+				}
+				res.append("]s", 2);
+			}
+		}
+		static size_t formatted_size(U d)
+		{
+			size_t count = 0;
+			if constexpr (std::is_floating_point_v<Rep>)
+				count = detail::formatted_size_of<Rep>(d.count());
+			else
+				count = detail::formatted_size_of<num_base<Rep, 10>>(decimal(d.count()));
+			return count + 2 * format_trait<num_base<std::intmax_t, 10>>::max_length + 4;
+		}
+	};
+} // namespace lava::format::legacy
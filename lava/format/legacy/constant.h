@@ -0,0 +1,235 @@
+#pragma once
+#include "ansi.h"
+#include "basic.h"
+#include "integers.h"
+#include <string_view>
+#include <type_traits>
+
+namespace lava::format::legacy
+{
+	// a string of at most N characters, built at compile time
+	// it is a sink in constant expressions
+	template<size_t N>
+	struct fixed_string
+	{
+		char text[N + 1]{};
+		size_t length{0};
+
+		constexpr void push_back(char c) { text[length++] = c; }
+		constexpr void append(const char* s, size_t n)
+		{
+			for (size_t i = 0; i != n; ++i)
+				text[length++] = s[i];
+		}
+		constexpr std::string_view view() const noexcept { return {text, length}; }
+		constexpr const char* c_str() const noexcept { return text; }
+		constexpr size_t size() const noexcept { return length; }
+	};
+
+	template<size_t N> // format a string built at compile time
+	struct format_trait<fixed_string<N>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const fixed_string<N>& s) { res.append(s.text, s.length); }
+		static constexpr size_t max_length = N;
+		static constexpr size_t formatted_size(const fixed_string<N>& s) { return s.length; }
+		static constexpr std::string_view view(const fixed_string<N>& s) { return s.view(); }
+	};
+
+	// a text formatted at compile time, with and without its ANSI escape sequences
+	// the version written is chosen at runtime, see `colour_enabled`
+	template<size_t N>
+	struct constant_text
+	{
+		fixed_string<N> coloured;
+		fixed_string<N> plain;
+
+		std::string_view view() const
+		{
+#ifndef LAVA_DISABLE_ANSI_ESCAPE_SEQUENCE
+			if (colour_enabled())
+				return coloured.view();
+#endif
+			return plain.view();
+		}
+		operator std::string_view() const { return view(); }
+	};
+
+	template<size_t N> // format a text formatted at compile time
+	struct format_trait<constant_text<N>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const constant_text<N>& s)
+		{
+			const std::string_view v = s.view();
+			res.append(v.data(), v.size());
+		}
+		static constexpr size_t max_length = N;
+		static size_t formatted_size(const constant_text<N>& s) { return s.view().size(); }
+		static std::string_view view(const constant_text<N>& s) { return s.view(); }
+	};
+
+	// a placeholder for the argument `index` of a message, given at runtime
+	// a message is split at its slots, see `format_message`
+	struct slot
+	{
+		unsigned char index;
+	};
+
+	// a string of at most N characters built at compile time, split at K slots in K + 1 fragments
+	template<size_t N, size_t K>
+	struct fragmented_string
+	{
+		fixed_string<N> text{};
+		size_t ends[K + 1]{};         // the end of each fragment in `text`
+		unsigned char slots[K + 1]{}; // the argument written after each fragment
+		size_t count{0};              // the slots seen so far
+
+		constexpr void push_back(char c) { text.push_back(c); }
+		constexpr void append(const char* s, size_t n) { text.append(s, n); }
+		constexpr void split(slot x)
+		{
+			ends[count] = text.length;
+			slots[count++] = x.index;
+		}
+	};
+
+	// a message with its constant parts formatted at compile time, with and without ANSI escape sequences
+	template<size_t N, size_t K>
+	struct constant_message
+	{
+		fragmented_string<N, K> coloured;
+		fragmented_string<N, K> plain;
+	};
+
+	namespace detail
+	{
+		// a sink counting the characters and the slots, in constant expressions
+		struct constant_counter
+		{
+			size_t length{0};
+			size_t slots{0};
+			constexpr void push_back(char) { ++length; }
+			constexpr void append(const char*, size_t n) { length += n; }
+			constexpr void split(slot) { ++slots; }
+		};
+
+		template<typename T>
+		struct is_num_base : std::false_type
+		{};
+		template<typename T, T base, bool capital>
+		struct is_num_base<num_base<T, base, capital>> : std::true_type
+		{};
+
+		// the digits are extracted one at a time, speed does not matter at compile time
+		template<typename Sink, typename T, T base, bool capital>
+		constexpr void format_constant_number(Sink& res, num_base<T, base, capital> ux)
+		{
+			using V = typename integer_traits<T>::unsigned_type;
+			constexpr size_t max_length = format_trait<num_base<T, base, capital>>::max_length;
+			V x = static_cast<V>(ux.value);
+			if constexpr (integer_traits<T>::is_signed)
+				if (ux.value < 0)
+				{
+					res.push_back('-');
+					x = static_cast<V>(V{0} - x);
+				}
+			char buffer[max_length]{};
+			size_t n = 0;
+			do
+			{
+				buffer[max_length - ++n] = digits<capital>[static_cast<unsigned>(x % static_cast<V>(base))];
+				x /= static_cast<V>(base);
+			} while (x != 0);
+			res.append(buffer + max_length - n, n);
+		}
+
+		// format `x` in a constant expression
+		// supported: texts (e.g. lava::enums::name_of), characters, booleans, num_base, ansi and endl,
+		// and slots for messages
+		template<bool colour, typename Sink, typename T>
+		constexpr void format_constant_one(Sink& res, const T& x)
+		{
+			if constexpr (std::is_same_v<T, char>)
+				res.push_back(x);
+			else if constexpr (std::is_same_v<T, bool>)
+			{
+				if (x)
+					res.append("true", 4);
+				else
+					res.append("false", 5);
+			}
+			else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+			{
+				const std::string_view s = x;
+				res.append(s.data(), s.size());
+			}
+			else if constexpr (std::is_same_v<T, ansi>)
+			{
+				if constexpr (colour)
+					res.append(x.sequence().data(), x.sequence().size());
+			}
+			else if constexpr (std::is_same_v<T, endl_t>)
+				res.push_back('\n');
+			else if constexpr (is_num_base<T>::value)
+				format_constant_number(res, x);
+			else if constexpr (std::is_same_v<T, slot>)
+				res.split(x);
+			else
+				static_assert(!sizeof(T), "lava::format: this type cannot be formatted at compile time.");
+		}
+	} // namespace detail
+
+	// the length of all the parameters formatted, in a constant expression
+	template<bool colour = true, typename... Us>
+	constexpr size_t constant_size(const Us&... xs)
+	{
+		detail::constant_counter res{};
+		(detail::format_constant_one<colour>(res, xs), ...);
+		return res.length;
+	}
+
+	// the count of slots in the parameters, in a constant expression
+	template<typename... Us>
+	constexpr size_t constant_slots(const Us&... xs)
+	{
+		detail::constant_counter res{};
+		(detail::format_constant_one<true>(res, xs), ...);
+		return res.slots;
+	}
+
+	// format_message: format all the parameters at compile time, split at their K slots
+	// N is usually `constant_size(xs...)`, and K `constant_slots(xs...)`
+	template<size_t N, size_t K, typename... Us>
+	constexpr constant_message<N, K> format_message(const Us&... xs)
+	{
+		constant_message<N, K> res{};
+		(detail::format_constant_one<true>(res.coloured, xs), ...);
+		(detail::format_constant_one<false>(res.plain, xs), ...);
+		res.coloured.ends[K] = res.coloured.text.length;
+		res.plain.ends[K] = res.plain.text.length;
+		return res;
+	}
+
+	// format_constant: format all the parameters to a string of at most N characters, at compile time
+	// N is usually `constant_size(xs...)`, see `fmtConstant`
+	template<size_t N, bool colour = true, typename... Us>
+	constexpr fixed_string<N> format_constant(const Us&... xs)
+	{
+		fixed_string<N> res{};
+		(detail::format_constant_one<colour>(res, xs), ...);
+		return res;
+	}
+
+	// fmtConstant: format the parameters, all constants, at compile time
+	// they are literals, or constants of static storage (a local `constexpr` is not captured)
+	// the result is a `const constant_text<N>&` to static storage, written as the colour policy chooses
+#define fmtConstant(...)                                                                             \
+	([]() -> const auto& {                                                                           \
+		constexpr size_t length = lava::format::legacy::constant_size(__VA_ARGS__);                  \
+		static constexpr lava::format::legacy::constant_text<length> text{                           \
+			lava::format::legacy::format_constant<length, true>(__VA_ARGS__),                        \
+			lava::format::legacy::format_constant<length, false>(__VA_ARGS__)};                      \
+		return text;                                                                                 \
+	}())
+} // namespace lava::format::legacy
@@ -1,6 +1,8 @@
 #pragma once
 #include "basic.h"
+#include "integers.h"
 #include <iterator>
+#include <string>
 #include <tuple>
 
 namespace lava::format::legacy
@@ -8,9 +10,14 @@ namespace lava::format::legacy
 	template<typename T, typename U> // format a std::pair
 	struct format_trait<std::pair<T, U>>
 	{
-		static void format_append(std::string& res, const std::pair<T, U>& p)
+		template<typename Sink>
+		static void format_append(Sink& res, const std::pair<T, U>& p)
 		{
-			format_s(res, '<', p.first, ',', p.second, '>');
+			format_to(res, '<', p.first, ',', p.second, '>');
+		}
+		static size_t formatted_size(const std::pair<T, U>& p)
+		{
+			return 3 + legacy::formatted_size(p.first, p.second);
 		}
 	};
 
@@ -36,11 +43,17 @@ namespace lava::format::legacy
 			tuple_f<F, std::make_index_sequence<sizeof...(Ts) - 1>, Ts...>::foreach_tuple(t, f);
 		}
 
-		static void format_append(std::string& res, const std::tuple<Args...>& t)
+		template<typename Sink>
+		static void format_append(Sink& res, const std::tuple<Args...>& t)
 		{
-			format_s(res, '<', std::get<0>(t));
-			foreach_tuple(t, [&res](const auto& v) { format_s(res, ',', v); });
-			format_s(res, '>');
+			format_to(res, '<', std::get<0>(t));
+			foreach_tuple(t, [&res](const auto& v) { format_to(res, ',', v); });
+			res.push_back('>');
+		}
+		static size_t formatted_size(const std::tuple<Args...>& t)
+		{
+			auto size_of = [](const auto&... xs) { return legacy::formatted_size(xs...); };
+			return 1 + sizeof...(Args) + std::apply(size_of, t);
 		}
 	};
 
@@ -56,7 +69,9 @@ namespace lava::format::legacy
 	template<typename F> // the identity wrapper
 	struct format_trait<identity<F>>
 	{
-		static void format_append(std::string& res, const identity<F>& c) { format_s(res, c.f); }
+		template<typename Sink>
+		static void format_append(Sink& res, const identity<F>& c) { format_to(res, c.f); }
+		static size_t formatted_size(const identity<F>& c) { return legacy::formatted_size(c.f); }
 	};
 
 	template<typename F, typename C>
@@ -70,21 +85,106 @@ namespace lava::format::legacy
 		return container<F, C>{c};
 	}
 
+	// trait has_max_length<T>: whether format_trait<T> formats every T to at most `max_length` characters
+	template<typename T, typename = void>
+	struct has_max_length : std::false_type
+	{};
+	template<typename T>
+	struct has_max_length<T, std::void_t<decltype(format_trait<T>::max_length)>> : std::true_type
+	{};
+
+	// trait has_size<C>: whether std::size works on C
+	template<typename C, typename = void>
+	struct has_size : std::false_type
+	{};
+	template<typename C>
+	struct has_size<C, std::void_t<decltype(std::size(std::declval<const C&>()))>> : std::true_type
+	{};
+
+	namespace detail
+	{
+		// trait is_integer_array<F, C>: whether C is contiguous, of the integers wrapped by `num_base` F,
+		// so that it is converted in bulk
+		template<typename F, typename C, typename = void>
+		struct is_integer_array : std::false_type
+		{};
+		template<typename T, T base, bool capital, typename C>
+		struct is_integer_array<num_base<T, base, capital>, C, std::void_t<decltype(std::data(std::declval<const C&>()))>>
+			: std::bool_constant<is_batch_integer<num_base<T, base, capital>>::value && has_size<C>::value
+								 && std::is_same_v<decltype(std::data(std::declval<const C&>())), const T*>>
+		{};
+
+		// format an array of integers in bulk: to the string directly, or through a stack buffer
+		template<typename F, typename Sink, typename T>
+		inline void format_integer_array(Sink& res, const T* p, size_t n)
+		{
+			constexpr size_t width = 1 + format_trait<F>::max_length;
+			if constexpr (std::is_same_v<Sink, std::string>)
+			{
+				const size_t start = res.size();
+				detail::reserve_append(res, n * width + 2 + batch_slack);
+				res.resize(start + n * width + 2 + batch_slack);
+				char* out = res.data() + start;
+				*out++ = '{';
+				out = write_integers<F>(out, p, p + n, ',');
+				*out++ = '}';
+				res.resize(static_cast<size_t>(out - res.data()));
+			}
+			else
+			{
+				constexpr size_t chunk = 64;
+				char buffer[chunk * width + batch_slack];
+				res.push_back('{');
+				for (size_t i = 0; i < n; i += chunk)
+				{
+					char* out = buffer;
+					if (i != 0)
+						*out++ = ',';
+					out = write_integers<F>(out, p + i, p + std::min(n, i + chunk), ',');
+					res.append(buffer, static_cast<size_t>(out - buffer));
+				}
+				res.push_back('}');
+			}
+		}
+	} // namespace detail
+
 	template<typename F, typename Container> // format a container
 	struct format_trait<container<F, Container>>
 	{
-		static void format_append(std::string& res, const container<F, Container>& c)
+		template<typename Sink>
+		static void format_append(Sink& res, const container<F, Container>& c)
+		{
+			// contiguous integers in base 10 or 16: each element is written in place, with SIMD where available
+			if constexpr (detail::is_integer_array<F, Container>::value)
+				detail::format_integer_array<F>(res, std::data(c.c), std::size(c.c));
+			else
+			{
+				if constexpr (std::is_same_v<Sink, std::string> && has_max_length<F>::value && has_size<Container>::value)
+					detail::reserve_append(res, formatted_size(c));
+				auto p = std::cbegin(c.c);
+				auto pend = std::cend(c.c);
+				res.push_back('{');
+				if (p != pend)
+				{
+					format_to(res, F{*p});
+					for (++p; p != pend; ++p)
+						format_to(res, ',', F{*p});
+				}
+				res.push_back('}');
+			}
+		}
+		static size_t formatted_size(const container<F, Container>& c)
 		{
-			auto p = std::cbegin(c.c);
-			auto pend = std::cend(c.c);
-			format_s(res, '{');
-			if (p != pend)
+			// elements of bounded length: no need to iterate
+			if constexpr (has_max_length<F>::value && has_size<Container>::value)
+				return 2 + std::size(c.c) * (1 + format_trait<F>::max_length);
+			else
 			{
-				format_s(res, F{*p});
-				for (++p; p != pend; ++p)
-					format_s(res, ',', F{*p});
+				size_t n = 2;
+				for (const auto& x : c.c)
+					n += 1 + legacy::formatted_size(F{x});
+				return n;
 			}
-			format_s(res, '}');
 		}
 	};
 } // namespace lava::format::legacy
@@ -0,0 +1,149 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define LAVA_FORMAT_HAS_SSE2
+#endif
+#if defined(LAVA_FORMAT_HAS_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#	include <immintrin.h>
+#	define LAVA_FORMAT_HAS_AVX2
+#endif
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#endif
+
+// escaping of character literals, scanning for the characters to escape in bulk
+namespace lava::format::legacy::detail
+{
+	// the letter after the backslash for each character to escape, 0 for the others
+	inline constexpr auto escape_table = [] {
+		std::array<char, 256> t{};
+		t['\0'] = '0';
+		t['\a'] = 'a';
+		t['\b'] = 'b';
+		t['\t'] = 't';
+		t['\n'] = 'n';
+		t['\v'] = 'v';
+		t['\f'] = 'f';
+		t['\r'] = 'r';
+		t['\\'] = '\\';
+		t['\''] = '\'';
+		t['"'] = '"';
+		return t;
+	}();
+
+	constexpr char escape_of(char c) noexcept { return escape_table[static_cast<unsigned char>(c)]; }
+
+	// the position of the first character to escape in [s, s + n), or n if there is none
+	inline size_t find_escape_scalar(const char* s, size_t n) noexcept
+	{
+		size_t i = 0;
+		while (i != n && escape_of(s[i]) == 0)
+			++i;
+		return i;
+	}
+
+	// the index of the lowest set bit of `x`, which is not 0
+	inline size_t lowest_bit(unsigned x) noexcept
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<size_t>(__builtin_ctz(x));
+#else
+		unsigned long i;
+		_BitScanForward(&i, x);
+		return i;
+#endif
+	}
+
+#ifdef LAVA_FORMAT_HAS_SSE2
+	// 16 characters at a time
+	inline size_t find_escape_sse2(const char* s, size_t n) noexcept
+	{
+		const __m128i seven = _mm_set1_epi8(7), six = _mm_set1_epi8(6), zero = _mm_setzero_si128();
+		const __m128i backslash = _mm_set1_epi8('\\'), quote = _mm_set1_epi8('\''), dquote = _mm_set1_epi8('"');
+		size_t i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+			// '\a' to '\r' are 7 to 13
+			const __m128i c = _mm_sub_epi8(v, seven);
+			__m128i hit = _mm_cmpeq_epi8(_mm_min_epu8(c, six), c);
+			hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, zero));
+			hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, backslash));
+			hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, quote));
+			hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, dquote));
+			if (const int mask = _mm_movemask_epi8(hit))
+				return i + lowest_bit(static_cast<unsigned>(mask));
+		}
+		return i + find_escape_scalar(s + i, n - i);
+	}
+#endif
+
+#ifdef LAVA_FORMAT_HAS_AVX2
+	// 32 characters at a time, only called if the processor supports AVX2
+	__attribute__((target("avx2"))) inline size_t find_escape_avx2(const char* s, size_t n) noexcept
+	{
+		const __m256i seven = _mm256_set1_epi8(7), six = _mm256_set1_epi8(6), zero = _mm256_setzero_si256();
+		const __m256i backslash = _mm256_set1_epi8('\\'), quote = _mm256_set1_epi8('\''), dquote = _mm256_set1_epi8('"');
+		size_t i = 0;
+		for (; i + 32 <= n; i += 32)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+			const __m256i c = _mm256_sub_epi8(v, seven);
+			__m256i hit = _mm256_cmpeq_epi8(_mm256_min_epu8(c, six), c);
+			hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, zero));
+			hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, backslash));
+			hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, quote));
+			hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, dquote));
+			if (const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hit)))
+				return i + lowest_bit(mask);
+		}
+		return i + find_escape_sse2(s + i, n - i);
+	}
+#endif
+
+	using find_escape_t = size_t (*)(const char*, size_t) noexcept;
+
+	// the best implementation for the processor running the program
+	inline find_escape_t select_find_escape() noexcept
+	{
+#ifdef LAVA_FORMAT_HAS_AVX2
+		if (__builtin_cpu_supports("avx2"))
+			return find_escape_avx2;
+#endif
+#ifdef LAVA_FORMAT_HAS_SSE2
+		return find_escape_sse2;
+#else
+		return find_escape_scalar;
+#endif
+	}
+
+	inline size_t find_escape(const char* s, size_t n) noexcept
+	{
+		if (n < 16)
+			return find_escape_scalar(s, n);
+		static const find_escape_t find = select_find_escape();
+		return find(s, n);
+	}
+
+	// append [s, s + n) to `res`, escaped as in a C++ literal
+	// runs of characters needing no escape are appended at once
+	template<typename Sink>
+	inline void escape_to(Sink& res, const char* s, size_t n)
+	{
+		for (;;)
+		{
+			const size_t i = find_escape(s, n);
+			if (i != 0)
+				res.append(s, i);
+			if (i == n)
+				return;
+			const char escaped[2] = {'\\', escape_of(s[i])};
+			res.append(escaped, 2);
+			s += i + 1;
+			n -= i + 1;
+		}
+	}
+} // namespace lava::format::legacy::detail
@@ -0,0 +1,191 @@
+#pragma once
+#include "basic.h"
+#include <charconv>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#ifndef __cpp_lib_to_chars
+#	include <cstdio>
+#	include <cstdlib>
+#endif
+
+namespace lava::format::legacy
+{
+	// 4 styles to format a floating-point number
+	enum class float_style : unsigned char
+	{
+		shortest,   // the shortest text that reads back to the same value
+		fixed,      // [-]ddd.ddd, `precision` digits after the point
+		scientific, // [-]d.ddde[+-]dd, `precision` digits after the point
+		general     // fixed or scientific, `precision` significant digits, as "%g"
+	};
+
+	template<typename T, float_style style = float_style::shortest, bool capital = false>
+	struct float_base // format a floating-point number in the given style
+	{
+		static_assert(std::is_floating_point_v<T>, "Only floating-point numbers allowed.");
+		T value;
+		int precision{6};
+	};
+
+#define DEFINE_FLOAT_STYLE(name, style)                                       \
+	template<bool capital = false, typename T>                                \
+	constexpr float_base<T, style, capital> name(T x, int precision = 6)      \
+	{                                                                         \
+		return {x, precision};                                                \
+	}
+	// define helper functions for the 3 styles with a precision
+	DEFINE_FLOAT_STYLE(fixed, float_style::fixed)
+	DEFINE_FLOAT_STYLE(scientific, float_style::scientific)
+	DEFINE_FLOAT_STYLE(precision, float_style::general)
+#undef DEFINE_FLOAT_STYLE
+
+	namespace detail
+	{
+		constexpr int count_digits(int x) noexcept
+		{
+			int n = 1;
+			for (; x >= 10; x /= 10)
+				++n;
+			return n;
+		}
+
+		// an upper bound of the length of a formatted T
+		template<typename T>
+		constexpr size_t float_length(float_style style, int precision) noexcept
+		{
+			using limits = std::numeric_limits<T>;
+			// digits of the exponent, denormals included
+			constexpr size_t exponent = static_cast<size_t>(count_digits(limits::max_digits10 - limits::min_exponent10));
+			// in size_t: a precision near INT_MAX does not overflow
+			const size_t p = precision < 0 ? 6 : static_cast<size_t>(precision);
+			switch (style)
+			{
+			case float_style::fixed: // sign, integral part, point, fraction
+				return 1 + static_cast<size_t>(limits::max_exponent10) + 1 + 1 + p;
+			case float_style::scientific: // sign, digit, point, fraction, "e-", exponent
+				return 1 + 1 + 1 + p + 2 + exponent;
+			case float_style::general: // the longer of "-0.000ddd" and scientific
+				return 1 + 1 + 1 + p + 4 + 2 + exponent;
+			default: // sign, significant digits, point, "e-", exponent
+				return 1 + static_cast<size_t>(limits::max_digits10) + 1 + 2 + exponent;
+			}
+		}
+
+		// format `x` into [first, last), return the end, or nullptr if it does not fit
+		template<typename T>
+		inline char* write_float(char* first, char* last, T x, float_style style, int precision) noexcept
+		{
+#ifdef __cpp_lib_to_chars
+			std::to_chars_result r{};
+			switch (style)
+			{
+			case float_style::fixed:
+				r = std::to_chars(first, last, x, std::chars_format::fixed, precision);
+				break;
+			case float_style::scientific:
+				r = std::to_chars(first, last, x, std::chars_format::scientific, precision);
+				break;
+			case float_style::general:
+				r = std::to_chars(first, last, x, std::chars_format::general, precision);
+				break;
+			default: // shortest round-trip text, Ryu in common standard libraries
+				r = std::to_chars(first, last, x);
+				break;
+			}
+			return r.ec == std::errc{} ? r.ptr : nullptr;
+#else
+			// fallback for standard libraries without floating-point to_chars
+			// note that snprintf is affected by the locale
+			const auto size = static_cast<size_t>(last - first);
+			const auto print = [&](const char* f, int p) {
+				return std::snprintf(first, size, f, p, static_cast<long double>(x));
+			};
+			int n = 0;
+			switch (style)
+			{
+			case float_style::fixed:
+				n = print("%.*Lf", precision);
+				break;
+			case float_style::scientific:
+				n = print("%.*Le", precision);
+				break;
+			case float_style::general:
+				n = print("%.*Lg", precision);
+				break;
+			default: // the least precision which reads back to `x`
+				for (int p = 1; p <= std::numeric_limits<T>::max_digits10; ++p)
+				{
+					n = print("%.*Lg", p);
+					if (n < 0 || static_cast<size_t>(n) >= size || static_cast<T>(std::strtold(first, nullptr)) == x)
+						break;
+				}
+				break;
+			}
+			return n < 0 || static_cast<size_t>(n) >= size ? nullptr : first + n;
+#endif
+		}
+
+		template<typename T, typename Sink>
+		inline void format_float(Sink& res, T x, float_style style, int precision, bool capital)
+		{
+			const auto append = [&](char* first, char* last) {
+				if (capital)
+					for (char* p = first; p != last; ++p)
+						if (*p >= 'a' && *p <= 'z')
+							*p = static_cast<char>(*p - 'a' + 'A');
+				res.append(first, static_cast<size_t>(last - first));
+			};
+			char buffer[512];
+			if (char* end = write_float(buffer, buffer + sizeof(buffer), x, style, precision))
+				append(buffer, end);
+			else
+			{
+				// only for huge precisions
+				scoped_buffer scratch{};
+				std::string& temp = scratch.str();
+				temp.resize(float_length<T>(style, precision));
+				append(temp.data(), write_float(temp.data(), temp.data() + temp.size(), x, style, precision));
+			}
+		}
+	} // namespace detail
+
+	template<typename T, float_style style, bool capital> // format a floating-point number in a style
+	struct format_trait<float_base<T, style, capital>>
+	{
+		using U = float_base<T, style, capital>;
+		template<typename Sink>
+		static void format_append(Sink& res, U x)
+		{
+			detail::format_float(res, x.value, style, x.precision, capital);
+		}
+		static constexpr size_t formatted_size(U x) { return detail::float_length<T>(style, x.precision); }
+	};
+
+	namespace detail
+	{
+		// format a floating-point number, the shortest text which reads back to the same value
+		template<typename T>
+		struct float_trait
+		{
+			template<typename Sink>
+			static void format_append(Sink& res, T x)
+			{
+				format_float(res, x, float_style::shortest, -1, false);
+			}
+			static constexpr size_t max_length = float_length<T>(float_style::shortest, -1);
+			static constexpr size_t formatted_size(T) { return max_length; }
+		};
+	} // namespace detail
+
+	template<> // format a float
+	struct format_trait<float> : detail::float_trait<float>
+	{};
+	template<> // format a double
+	struct format_trait<double> : detail::float_trait<double>
+	{};
+	template<> // format a long double
+	struct format_trait<long double> : detail::float_trait<long double>
+	{};
+} // namespace lava::format::legacy
@@ -1,6 +1,15 @@
 #pragma once
 #include "basic.h"
+#include "escape.h"
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#endif
 
 namespace lava::format::legacy
 {
@@ -39,51 +48,410 @@ namespace lava::format::legacy
 	DEFINE_NUM_BASE(binary, 2)
 #undef DEFINE_NUM_BASE
 
+	namespace detail
+	{
+#ifdef __SIZEOF_INT128__
+		// 128-bit integers, a GNU extension
+		__extension__ typedef __int128 int128_t;
+		__extension__ typedef unsigned __int128 uint128_t;
+#endif
+
+		// integer_traits<T>: signedness and the unsigned counterpart of T
+		// std::is_signed/std::make_unsigned do not know 128-bit integers in strict ISO mode
+		template<typename T>
+		struct integer_traits
+		{
+			static constexpr bool is_signed = std::is_signed_v<T>;
+			using unsigned_type = std::make_unsigned_t<T>;
+		};
+#ifdef __SIZEOF_INT128__
+		template<>
+		struct integer_traits<int128_t>
+		{
+			static constexpr bool is_signed = true;
+			using unsigned_type = uint128_t;
+		};
+		template<>
+		struct integer_traits<uint128_t>
+		{
+			static constexpr bool is_signed = false;
+			using unsigned_type = uint128_t;
+		};
+#endif
+
+		// the count of significant bits in `x`, 0 for 0
+		template<typename V>
+		inline int bit_width(V x) noexcept
+		{
+			if constexpr (sizeof(V) > sizeof(unsigned long long))
+			{
+				const auto high = static_cast<unsigned long long>(x >> 64);
+				return high != 0 ? 64 + bit_width(high) : bit_width(static_cast<unsigned long long>(x));
+			}
+			else
+			{
+				const auto y = static_cast<unsigned long long>(x);
+#if defined(__GNUC__) || defined(__clang__)
+				return y == 0 ? 0 : 64 - __builtin_clzll(y);
+#elif defined(_MSC_VER) && defined(_M_X64)
+				unsigned long index;
+				return _BitScanReverse64(&index, y) ? static_cast<int>(index) + 1 : 0;
+#else
+				int n = 0;
+				for (auto z = y; z != 0; z >>= 1)
+					++n;
+				return n;
+#endif
+			}
+		}
+
+		// log2(base) if `base` is a power of 2, 0 otherwise
+		constexpr int log2_base(unsigned long long base) noexcept
+		{
+			if ((base & (base - 1)) != 0)
+				return 0;
+			int n = 0;
+			for (; base > 1; base >>= 1)
+				++n;
+			return n;
+		}
+
+		// "00", "01", ..., "99": two decimal digits at a time
+		inline constexpr auto decimal_pairs = [] {
+			std::array<char, 200> t{};
+			for (int i = 0; i < 100; ++i)
+			{
+				t[2 * i] = static_cast<char>('0' + i / 10);
+				t[2 * i + 1] = static_cast<char>('0' + i % 10);
+			}
+			return t;
+		}();
+
+		// "00", "01", ..., "FF": two hexadecimal digits (one byte) at a time
+		template<bool capital>
+		inline constexpr auto hexadecimal_pairs = [] {
+			const char* digits = capital ? "0123456789ABCDEF" : "0123456789abcdef";
+			std::array<char, 512> t{};
+			for (int i = 0; i < 256; ++i)
+			{
+				t[2 * i] = digits[i >> 4];
+				t[2 * i + 1] = digits[i & 0xF];
+			}
+			return t;
+		}();
+
+		// digits for all bases up to 36
+		template<bool capital>
+		inline constexpr const char* digits
+			= capital ? "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ" : "0123456789abcdefghijklmnopqrstuvwxyz";
+
+		// count the decimal digits of `x`
+		template<typename V>
+		constexpr int count_decimal_digits(V x) noexcept
+		{
+			for (int n = 1;; n += 4)
+			{
+				if (x < 10)
+					return n;
+				if (x < 100)
+					return n + 1;
+				if (x < 1000)
+					return n + 2;
+				if (x < 10000)
+					return n + 3;
+				x /= 10000u;
+			}
+		}
+
+		// write the decimal digits of `x` backwards, the last one right before `end`
+		template<typename V>
+		inline void write_decimal(char* end, V x) noexcept
+		{
+			for (; x >= 100; x /= 100u)
+			{
+				const auto i = static_cast<size_t>(x % 100u) * 2;
+				*--end = decimal_pairs[i + 1];
+				*--end = decimal_pairs[i];
+			}
+			if (x >= 10)
+			{
+				const auto i = static_cast<size_t>(x) * 2;
+				*--end = decimal_pairs[i + 1];
+				*--end = decimal_pairs[i];
+			}
+			else
+				*--end = static_cast<char>('0' + x);
+		}
+
+		// write the digits of `x` in base 2^shift backwards, the last one right before `end`
+		template<int shift, bool capital, typename V>
+		inline void write_power_of_2(char* end, V x) noexcept
+		{
+			if constexpr (shift == 4)
+			{
+				// hexadecimal: two digits (one byte) at a time
+				constexpr auto& pairs = hexadecimal_pairs<capital>;
+				for (; x >= 256; x >>= 8)
+				{
+					const auto i = static_cast<size_t>(x & 0xFFu) * 2;
+					*--end = pairs[i + 1];
+					*--end = pairs[i];
+				}
+				if (x >= 16)
+				{
+					const auto i = static_cast<size_t>(x) * 2;
+					*--end = pairs[i + 1];
+					*--end = pairs[i];
+				}
+				else
+					*--end = pairs[static_cast<size_t>(x) * 2 + 1];
+			}
+			else
+			{
+				constexpr unsigned mask = (1u << shift) - 1;
+				do
+				{
+					*--end = digits<capital>[static_cast<unsigned>(x) & mask];
+					x >>= shift;
+				} while (x != 0);
+			}
+		}
+	} // namespace detail
+
 	template<typename T, T base, bool capital> // format a integer with specified base
 	struct format_trait<num_base<T, base, capital>>
 	{
 		using U = num_base<T, base, capital>;
-		static char digit_of(T x)
-		{
-			if (x < 10) // 0-9
-				return static_cast<char>(x + '0');
-			if constexpr (capital) // A-Z
-				return static_cast<char>(x - 10 + 'A');
-			else // a-z
-				return static_cast<char>(x - 10 + 'a');
-		}
+		using V = typename detail::integer_traits<T>::unsigned_type;
+		static constexpr bool is_signed = detail::integer_traits<T>::is_signed;
+		static constexpr V radix = static_cast<V>(base);
+		// for bases 2^k, digits are extracted with shifts and masks
+		static constexpr int shift = detail::log2_base(static_cast<unsigned long long>(base));
+		// the maximum count of digits in base `base`, plus a sign for signed types
+		static constexpr size_t max_length = [] {
+			size_t n = 1;
+			for (auto x = static_cast<V>(~V{0}); x >= radix; x /= radix)
+				++n;
+			return n + is_signed;
+		}();
 
-		static void format_append(std::string& res, U ux)
+		// the digits are written into a stack buffer, then appended at once
+		template<typename Sink>
+		static void format_append(Sink& res, U ux)
 		{
-			T x = ux.value, x0 = x;
-			if (x == 0)
+			// negate in the unsigned type, so that the minimum value is handled
+			V x = static_cast<V>(ux.value);
+			bool negative = false;
+			if constexpr (is_signed)
+				if (ux.value < 0)
+				{
+					negative = true;
+					x = static_cast<V>(V{0} - x);
+				}
+
+			char buffer[max_length];
+			buffer[0] = '-';
+			if constexpr (shift != 0)
 			{
-				res.push_back('0');
-				return;
+				// the length is known up front from the leading zero count
+				const int bits = std::max(detail::bit_width(x), 1);
+				const int n = negative + (bits + shift - 1) / shift;
+				detail::write_power_of_2<shift, capital>(buffer + n, x);
+				res.append(buffer, static_cast<size_t>(n));
 			}
-			std::string temp;
-			if constexpr (std::is_signed_v<T>)
-				if (x < 0)
-					x = -x;
-			do
+			else if constexpr (base == 10 && sizeof(V) <= sizeof(unsigned long long))
 			{
-				temp.push_back(digit_of(x % base));
-				x /= base;
-			} while (x != 0);
-			if constexpr (std::is_signed_v<T>)
-				if (x0 < 0)
-					temp.push_back('-');
-			static_cast<void>(x0);
-			res.append(temp.crbegin(), temp.crend());
+				// the length is known up front, digits are written 2 at a time
+				const int n = negative + detail::count_decimal_digits(x);
+				detail::write_decimal(buffer + n, x);
+				res.append(buffer, static_cast<size_t>(n));
+			}
+			else if constexpr (base == 10)
+			{
+				// wider than 64 bits: split into 19-digit chunks, each formatted in 64 bits
+				constexpr unsigned long long chunk = 10000000000000000000ull;
+				char* const end = buffer + max_length;
+				char* p = end;
+				for (; x >= chunk; x /= chunk)
+				{
+					const auto low = static_cast<unsigned long long>(x % chunk);
+					const int n = detail::count_decimal_digits(low);
+					detail::write_decimal(p, low);
+					p -= 19;
+					std::fill(p, p + 19 - n, '0');
+				}
+				const auto high = static_cast<unsigned long long>(x);
+				detail::write_decimal(p, high);
+				p -= detail::count_decimal_digits(high);
+				if (negative)
+					*--p = '-';
+				res.append(p, static_cast<size_t>(end - p));
+			}
+			else
+			{
+				char* const end = buffer + max_length;
+				char* p = end;
+				do
+				{
+					*--p = detail::digits<capital>[static_cast<unsigned>(x % radix)];
+					x /= radix;
+				} while (x != 0);
+				if (negative)
+					*--p = '-';
+				res.append(p, static_cast<size_t>(end - p));
+			}
 		}
+		static constexpr size_t formatted_size(U) { return max_length; }
 	};
 
+	namespace detail
+	{
+		// bulk conversion of integer arrays: each element is written forward, at its final place,
+		// with no bound check; up to `batch_slack` bytes past the end of the text may be clobbered
+		inline constexpr size_t batch_slack = 16;
+
+#ifdef LAVA_FORMAT_HAS_SSE2
+		// the 8 decimal digits of `x` < 10^8, in ASCII, the first one in the lowest byte
+		// abcd and efgh are split off, then a, ab, abc, abcd (and e...) are found at once with multiplications
+		inline __m128i decimal_8_sse2(std::uint32_t x) noexcept
+		{
+			const __m128i abcdefgh = _mm_cvtsi32_si128(static_cast<int>(x));
+			const __m128i abcd = _mm_srli_epi64(_mm_mul_epu32(abcdefgh, _mm_set1_epi32(static_cast<int>(0xD1B71759u))), 45);
+			const __m128i efgh = _mm_sub_epi32(abcdefgh, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+			const __m128i v1 = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+			const __m128i v2a = _mm_unpacklo_epi16(v1, v1);
+			const __m128i v2 = _mm_unpacklo_epi32(v2a, v2a);
+			// divided by 1000, 100, 10 and 1: [a, ab, abc, abcd, e, ef, efg, efgh]
+			const __m128i v3 = _mm_mulhi_epu16(v2, _mm_setr_epi16(8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768));
+			const __m128i v4 = _mm_mulhi_epu16(v3, _mm_setr_epi16(1 << 7, 1 << 11, 1 << 13, -32768, 1 << 7, 1 << 11, 1 << 13, -32768));
+			// minus 10 times the previous lane: [a, b, c, d, e, f, g, h]
+			const __m128i v5 = _mm_sub_epi16(v4, _mm_slli_epi64(_mm_mullo_epi16(v4, _mm_set1_epi16(10)), 16));
+			return _mm_add_epi8(_mm_packus_epi16(v5, _mm_setzero_si128()), _mm_set1_epi8('0'));
+		}
+
+		// write the last `n` of the 8 digits of `x` < 10^8 at `out`, 8 bytes are written
+		inline void store_decimal_8(char* out, std::uint32_t x, int n) noexcept
+		{
+			const __m128i d = _mm_srl_epi64(decimal_8_sse2(x), _mm_cvtsi32_si128((8 - n) * 8));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(out), d);
+		}
+
+		// write the 16 hexadecimal digits of `x` at `out`
+		template<bool capital>
+		inline void store_hexadecimal_16(char* out, std::uint64_t x) noexcept
+		{
+#	if defined(__GNUC__) || defined(__clang__)
+			const std::uint64_t big_endian = __builtin_bswap64(x);
+#	else
+			const std::uint64_t big_endian = _byteswap_uint64(x);
+#	endif
+			const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&big_endian));
+			const __m128i mask = _mm_set1_epi8(0x0F);
+			const __m128i nibbles = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(v, 4), mask), _mm_and_si128(v, mask));
+			const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8((capital ? 'A' : 'a') - '0' - 10));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters));
+		}
+#endif
+
+		// write the decimal digits of `x` at `out`, return past the last one
+		template<typename V>
+		inline char* write_decimal_forward(char* out, V x) noexcept
+		{
+#ifdef LAVA_FORMAT_HAS_SSE2
+			constexpr std::uint32_t e8 = 100000000u;
+			if (x < e8)
+			{
+				const int n = count_decimal_digits(x);
+				store_decimal_8(out, static_cast<std::uint32_t>(x), n);
+				return out + n;
+			}
+			// the digits above the last 16, at most 4 of them for 64 bits
+			if constexpr (sizeof(V) > 4)
+				if (x >= 10000000000000000ull)
+				{
+					const auto top = static_cast<std::uint32_t>(x / 10000000000000000ull);
+					x %= 10000000000000000ull;
+					out += count_decimal_digits(top);
+					write_decimal(out, top);
+					store_decimal_8(out, static_cast<std::uint32_t>(x / e8), 8);
+					store_decimal_8(out + 8, static_cast<std::uint32_t>(x % e8), 8);
+					return out + 16;
+				}
+			const auto high = static_cast<std::uint32_t>(x / e8);
+			const int n = count_decimal_digits(high);
+			store_decimal_8(out, high, n);
+			store_decimal_8(out + n, static_cast<std::uint32_t>(x % e8), 8);
+			return out + n + 8;
+#else
+			const int n = count_decimal_digits(x);
+			write_decimal(out + n, x);
+			return out + n;
+#endif
+		}
+
+		// write the hexadecimal digits of `x` at `out`, return past the last one
+		template<bool capital, typename V>
+		inline char* write_hexadecimal_forward(char* out, V x) noexcept
+		{
+			const int n = (std::max(bit_width(x), 1) + 3) / 4;
+#ifdef LAVA_FORMAT_HAS_SSE2
+			// the digits are moved to the top, then all 16 are written
+			store_hexadecimal_16<capital>(out, static_cast<std::uint64_t>(x) << (64 - 4 * n));
+#else
+			write_power_of_2<4, capital>(out + n, x);
+#endif
+			return out + n;
+		}
+
+		// trait is_batch_integer<F>: whether arrays of F are converted in bulk, see `write_integers`
+		template<typename F>
+		struct is_batch_integer : std::false_type
+		{};
+		template<typename T, T base, bool capital>
+		struct is_batch_integer<num_base<T, base, capital>>
+			: std::bool_constant<std::is_integral_v<T> && !std::is_same_v<T, bool> && sizeof(T) <= 8 && (base == 10 || base == 16)>
+		{};
+
+		// write the elements of [p, last) in base 10 or 16, separated by `separator`, at `out`
+		// return past the last character written; see `batch_slack`
+		template<typename F, typename T>
+		inline char* write_integers(char* out, const T* p, const T* last, char separator) noexcept
+		{
+			using V = std::make_unsigned_t<T>;
+			for (bool first = true; p != last; ++p, first = false)
+			{
+				if (!first)
+					*out++ = separator;
+				auto x = static_cast<V>(*p);
+				if constexpr (std::is_signed_v<T>)
+					if (*p < 0)
+					{
+						*out++ = '-';
+						x = static_cast<V>(V{0} - x);
+					}
+				if constexpr (std::is_same_v<F, num_base<T, 16, true>>)
+					out = write_hexadecimal_forward<true>(out, x);
+				else if constexpr (std::is_same_v<F, num_base<T, 16, false>>)
+					out = write_hexadecimal_forward<false>(out, x);
+				else
+					out = write_decimal_forward(out, x);
+			}
+			return out;
+		}
+	} // namespace detail
+
 	template<> // format a boolean
 	struct format_trait<bool>
 	{
-		static void format_append(std::string& res, bool x)
+		template<typename Sink>
+		static void format_append(Sink& res, bool x)
 		{
-			res.append(x ? "true" : "false");
+			if (x)
+				res.append("true", 4);
+			else
+				res.append("false", 5);
 		}
+		static constexpr size_t max_length = 5;
+		static constexpr size_t formatted_size(bool) { return max_length; }
 	};
 } // namespace lava::format::legacy
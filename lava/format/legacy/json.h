@@ -0,0 +1,487 @@
+#pragma once
+#include "basic.h"
+#include "escape.h"
+#include "floats.h"
+#include "integers.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <lava/enums.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// JSON: values mapped from their C++ types, written with no intermediate string
+// not included from lava/format/legacy.h, for lava/enums.h includes lava/assert.h, which includes lava.format
+namespace lava::format::legacy
+{
+	// the JSON text of a user type T: specialize json_trait<T> with
+	// `static auto to_json(const T& x)` returning a value which is mapped to JSON, usually a json_object
+	template<typename T>
+	struct json_trait;
+
+	// a text written as a JSON string
+	struct json_string_t
+	{
+		std::string_view text;
+	};
+	inline json_string_t json_string(std::string_view s) noexcept { return {s}; }
+
+	// any value written as JSON
+	// lvalues are held by reference, rvalues are moved into the wrapper
+	template<typename T>
+	struct json_value
+	{
+		T value;
+	};
+	template<typename U>
+	inline json_value<U> json(U&& x)
+	{
+		return {std::forward<U>(x)};
+	}
+
+	// a member of a JSON object: a name and a value
+	template<typename T>
+	struct json_member
+	{
+		std::string_view name;
+		T value;
+	};
+	template<typename U>
+	inline json_member<U> json_field(std::string_view name, U&& x)
+	{
+		return {name, std::forward<U>(x)};
+	}
+
+	// a JSON object of the members given
+	template<typename... Ts>
+	struct json_object_t
+	{
+		std::tuple<json_member<Ts>...> members;
+	};
+	template<typename... Ts>
+	inline json_object_t<Ts...> json_object(json_member<Ts>... ms)
+	{
+		return {std::tuple<json_member<Ts>...>{std::move(ms)...}};
+	}
+
+	// a JSON array of the values given, of any types
+	template<typename... Ts>
+	struct json_array_t
+	{
+		std::tuple<Ts...> items;
+	};
+	template<typename... Us>
+	inline json_array_t<Us...> json_array(Us&&... xs)
+	{
+		return {std::tuple<Us...>{std::forward<Us>(xs)...}};
+	}
+
+	namespace detail
+	{
+		// the letter after the backslash for each character to escape in JSON, 'u' for \u00XX, 0 for the others
+		inline constexpr auto json_escape_table = [] {
+			std::array<char, 256> t{};
+			for (size_t c = 0; c != 0x20; ++c)
+				t[c] = 'u';
+			t['\b'] = 'b';
+			t['\t'] = 't';
+			t['\n'] = 'n';
+			t['\f'] = 'f';
+			t['\r'] = 'r';
+			t['\\'] = '\\';
+			t['"'] = '"';
+			return t;
+		}();
+
+		constexpr char json_escape_of(char c) noexcept { return json_escape_table[static_cast<unsigned char>(c)]; }
+
+		// the position of the first character to escape in [s, s + n), or n if there is none
+		inline size_t find_json_escape_scalar(const char* s, size_t n) noexcept
+		{
+			size_t i = 0;
+			while (i != n && json_escape_of(s[i]) == 0)
+				++i;
+			return i;
+		}
+
+#ifdef LAVA_FORMAT_HAS_SSE2
+		// 16 characters at a time
+		inline size_t find_json_escape_sse2(const char* s, size_t n) noexcept
+		{
+			const __m128i control = _mm_set1_epi8(0x1F);
+			const __m128i backslash = _mm_set1_epi8('\\'), dquote = _mm_set1_epi8('"');
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+				// control characters are at most 0x1F, unsigned
+				__m128i hit = _mm_cmpeq_epi8(_mm_min_epu8(v, control), v);
+				hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, backslash));
+				hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, dquote));
+				if (const int mask = _mm_movemask_epi8(hit))
+					return i + lowest_bit(static_cast<unsigned>(mask));
+			}
+			return i + find_json_escape_scalar(s + i, n - i);
+		}
+#endif
+
+#ifdef LAVA_FORMAT_HAS_AVX2
+		// 32 characters at a time, only called if the processor supports AVX2
+		__attribute__((target("avx2"))) inline size_t find_json_escape_avx2(const char* s, size_t n) noexcept
+		{
+			const __m256i control = _mm256_set1_epi8(0x1F);
+			const __m256i backslash = _mm256_set1_epi8('\\'), dquote = _mm256_set1_epi8('"');
+			size_t i = 0;
+			for (; i + 32 <= n; i += 32)
+			{
+				const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+				__m256i hit = _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v);
+				hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, backslash));
+				hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, dquote));
+				if (const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hit)))
+					return i + lowest_bit(mask);
+			}
+			return i + find_json_escape_sse2(s + i, n - i);
+		}
+#endif
+
+		// the best implementation for the processor running the program
+		inline find_escape_t select_find_json_escape() noexcept
+		{
+#ifdef LAVA_FORMAT_HAS_AVX2
+			if (__builtin_cpu_supports("avx2"))
+				return find_json_escape_avx2;
+#endif
+#ifdef LAVA_FORMAT_HAS_SSE2
+			return find_json_escape_sse2;
+#else
+			return find_json_escape_scalar;
+#endif
+		}
+
+		inline size_t find_json_escape(const char* s, size_t n) noexcept
+		{
+			if (n < 16)
+				return find_json_escape_scalar(s, n);
+			static const find_escape_t find = select_find_json_escape();
+			return find(s, n);
+		}
+
+		// append [s, s + n) to `res` as a JSON string, quotes included
+		// runs of characters needing no escape are appended at once, UTF-8 is kept as-is
+		template<typename Sink>
+		inline void json_escape_to(Sink& res, const char* s, size_t n)
+		{
+			res.push_back('"');
+			for (;;)
+			{
+				const size_t i = find_json_escape(s, n);
+				if (i != 0)
+					res.append(s, i);
+				if (i == n)
+					break;
+				const char e = json_escape_of(s[i]);
+				if (e != 'u')
+				{
+					const char escaped[2] = {'\\', e};
+					res.append(escaped, 2);
+				}
+				else
+				{
+					const auto c = static_cast<unsigned char>(s[i]);
+					const char escaped[6] = {'\\', 'u', '0', '0', digits<false>[c >> 4], digits<false>[c & 0xF]};
+					res.append(escaped, 6);
+				}
+				s += i + 1;
+				n -= i + 1;
+			}
+			res.push_back('"');
+		}
+
+		// sink: a std::string written through a cursor, with one bound check for each piece
+		// the string is extended ahead of the cursor, and cut back to the text written on destruction
+		class json_cursor
+		{
+		public:
+			explicit json_cursor(std::string& s)
+				: res{s}
+				, start{s.size()}
+				, out{s.data() + s.size()}
+				, last{out}
+			{}
+			~json_cursor() { res.resize(static_cast<size_t>(out - res.data())); }
+			json_cursor(const json_cursor&) = delete;
+			json_cursor& operator=(const json_cursor&) = delete;
+
+			void push_back(char c)
+			{
+				if (out == last)
+					grow(1);
+				*out++ = c;
+			}
+			void append(const char* s, size_t n)
+			{
+				if (static_cast<size_t>(last - out) < n)
+					grow(n);
+				std::memcpy(out, s, n);
+				out += n;
+			}
+
+		private:
+			// extend the string geometrically, relative to the text written so far
+			void grow(size_t n)
+			{
+				const size_t used = static_cast<size_t>(out - res.data());
+				res.resize(used + std::max({n, used - start, size_t{256}}));
+				out = res.data() + used;
+				last = res.data() + res.size();
+			}
+
+			std::string& res;
+			size_t start;
+			char* out;
+			char* last;
+		};
+
+		// append the name of a member to `res`, quoted and followed by a colon
+		// short names with nothing to escape, the usual case, are appended at once
+		template<typename Sink>
+		inline void json_write_name(Sink& res, std::string_view name)
+		{
+			constexpr size_t short_name = 60;
+			if (name.size() <= short_name && find_json_escape_scalar(name.data(), name.size()) == name.size())
+			{
+				char buffer[short_name + 3];
+				buffer[0] = '"';
+				std::memcpy(buffer + 1, name.data(), name.size());
+				buffer[name.size() + 1] = '"';
+				buffer[name.size() + 2] = ':';
+				res.append(buffer, name.size() + 3);
+				return;
+			}
+			json_escape_to(res, name.data(), name.size());
+			res.push_back(':');
+		}
+
+		// each character is escaped to at most 6 characters, \u00XX
+		constexpr size_t json_string_size(size_t n) noexcept { return 6 * n + 2; }
+
+		template<typename T, typename = void>
+		struct has_json_trait : std::false_type
+		{};
+		template<typename T>
+		struct has_json_trait<T, std::void_t<decltype(json_trait<T>::to_json(std::declval<const T&>()))>> : std::true_type
+		{};
+
+		template<typename T, typename = void>
+		struct is_range : std::false_type
+		{};
+		template<typename T>
+		struct is_range<T, std::void_t<decltype(std::begin(std::declval<const T&>()), std::end(std::declval<const T&>()))>>
+			: std::true_type
+		{};
+
+		template<typename T>
+		struct is_optional : std::false_type
+		{};
+		template<typename T>
+		struct is_optional<std::optional<T>> : std::true_type
+		{};
+
+		template<typename T>
+		struct is_pair_or_tuple : std::false_type
+		{};
+		template<typename T, typename U>
+		struct is_pair_or_tuple<std::pair<T, U>> : std::true_type
+		{};
+		template<typename... Ts>
+		struct is_pair_or_tuple<std::tuple<Ts...>> : std::true_type
+		{};
+
+		// whether the elements of range T are pairs with a text as the key, written as a JSON object
+		template<typename T, typename = void>
+		struct is_map : std::false_type
+		{};
+		template<typename T>
+		struct is_map<T, std::void_t<typename T::key_type, typename T::mapped_type>>
+			: std::is_convertible<const typename T::key_type&, std::string_view>
+		{};
+
+		template<typename Sink, typename T>
+		inline void json_write(Sink& res, const T& x);
+
+		// the elements of a tuple, separated by commas
+		template<typename Sink, typename Tuple>
+		inline void json_write_items(Sink& res, const Tuple& t)
+		{
+			std::apply(
+				[&res](const auto&... xs) {
+					bool first = true;
+					((first ? static_cast<void>(first = false) : res.push_back(','), json_write(res, xs)), ...);
+				},
+				t);
+		}
+
+		// write `x` as JSON, mapped from its type
+		// other types are written by their format_trait, e.g. json_object and json_array nested
+		template<typename Sink, typename T>
+		inline void json_write(Sink& res, const T& x)
+		{
+			if constexpr (has_json_trait<T>::value)
+				json_write(res, json_trait<T>::to_json(x));
+			else if constexpr (std::is_same_v<T, json_string_t>)
+				json_escape_to(res, x.text.data(), x.text.size());
+			else if constexpr (std::is_same_v<T, bool>)
+			{
+				if (x)
+					res.append("true", 4);
+				else
+					res.append("false", 5);
+			}
+			else if constexpr (std::is_same_v<T, std::nullptr_t> || std::is_same_v<T, std::nullopt_t>)
+				res.append("null", 4);
+			else if constexpr (is_char<T>)
+				json_escape_to(res, &x, 1);
+			else if constexpr (std::is_integral_v<T>)
+				format_one(res, decimal(x));
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				// JSON has no infinity nor NaN
+				if (std::isfinite(x))
+					format_one(res, x);
+				else
+					res.append("null", 4);
+			}
+			else if constexpr (std::is_enum_v<T>)
+			{
+				const std::string_view name = lava::enums::name_of(x);
+				json_escape_to(res, name.data(), name.size());
+			}
+			else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+			{
+				const std::string_view s = x;
+				json_escape_to(res, s.data(), s.size());
+			}
+			else if constexpr (is_optional<T>::value)
+			{
+				if (x)
+					json_write(res, *x);
+				else
+					res.append("null", 4);
+			}
+			else if constexpr (is_pair_or_tuple<T>::value)
+			{
+				res.push_back('[');
+				json_write_items(res, x);
+				res.push_back(']');
+			}
+			else if constexpr (is_map<T>::value)
+			{
+				res.push_back('{');
+				bool first = true;
+				for (const auto& [k, v] : x)
+				{
+					if (!first)
+						res.push_back(',');
+					first = false;
+					json_write_name(res, k);
+					json_write(res, v);
+				}
+				res.push_back('}');
+			}
+			else if constexpr (is_range<T>::value)
+			{
+				res.push_back('[');
+				bool first = true;
+				for (const auto& v : x)
+				{
+					if (!first)
+						res.push_back(',');
+					first = false;
+					json_write(res, v);
+				}
+				res.push_back(']');
+			}
+			else
+				format_one(res, x);
+		}
+	} // namespace detail
+
+	template<> // format a JSON string
+	struct format_trait<json_string_t>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, json_string_t s) { detail::json_escape_to(res, s.text.data(), s.text.size()); }
+		static constexpr size_t formatted_size(json_string_t s) { return detail::json_string_size(s.text.size()); }
+	};
+
+	// JSON values, objects and arrays report no formatted_size: measuring would walk the value twice,
+	// strings are written through a json_cursor instead, which extends them as needed
+
+	template<typename T> // format a value as JSON
+	struct format_trait<json_value<T>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const json_value<T>& x)
+		{
+			if constexpr (std::is_same_v<Sink, std::string>)
+			{
+				detail::json_cursor out{res};
+				detail::json_write(out, x.value);
+			}
+			else
+				detail::json_write(res, x.value);
+		}
+	};
+
+	template<typename... Ts> // format a JSON object
+	struct format_trait<json_object_t<Ts...>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const json_object_t<Ts...>& o)
+		{
+			if constexpr (std::is_same_v<Sink, std::string>)
+			{
+				detail::json_cursor out{res};
+				format_append(out, o);
+				return;
+			}
+			res.push_back('{');
+			std::apply(
+				[&res](const auto&... ms) {
+					bool first = true;
+					((first ? static_cast<void>(first = false) : res.push_back(','),
+					  detail::json_write_name(res, ms.name),
+					  detail::json_write(res, ms.value)),
+					 ...);
+				},
+				o.members);
+			res.push_back('}');
+		}
+	};
+
+	template<typename... Ts> // format a JSON array
+	struct format_trait<json_array_t<Ts...>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const json_array_t<Ts...>& a)
+		{
+			if constexpr (std::is_same_v<Sink, std::string>)
+			{
+				detail::json_cursor out{res};
+				format_append(out, a);
+				return;
+			}
+			res.push_back('[');
+			detail::json_write_items(res, a.items);
+			res.push_back(']');
+		}
+	};
+} // namespace lava::format::legacy
@@ -1,6 +1,9 @@
 #pragma once
 #include "basic.h"
+#include "utf.h"
 #include <string>
+#include <tuple>
+#include <utility>
 
 namespace lava::format::legacy
 {
@@ -12,9 +15,36 @@ namespace lava::format::legacy
 		right
 	};
 
-	// align the contents and fill the blank
-	// note that this trait will force the content be formatted as string first
-	// this implies that every layer of `fill_t` introduces a full traverse on the content
+	namespace detail
+	{
+		// the count of fill characters before and after a content of `n` columns
+		inline std::pair<size_t, size_t> padding(size_t n, int width, alignment align) noexcept
+		{
+			if (width < 0 || n >= static_cast<size_t>(width))
+				return {0, 0};
+			const size_t delta = static_cast<size_t>(width) - n;
+			if (align == alignment::left)
+				return {0, delta};
+			if (align == alignment::right)
+				return {delta, 0};
+			return {delta / 2, (delta + 1) / 2};
+		}
+
+		template<typename Sink>
+		inline void pad(Sink& res, char c, size_t n)
+		{
+			if constexpr (std::is_same_v<Sink, std::string>)
+				res.append(n, c);
+			else
+				for (; n != 0; --n)
+					res.push_back(c);
+		}
+	} // namespace detail
+
+	// contents are measured in display columns, see `display_width`
+
+	// align the contents and fill the blank, with the contents already formatted
+	// prefer `left`, `right` and `center` below, which format the contents lazily
 	struct fill_t
 	{
 		std::string content;
@@ -25,51 +55,106 @@ namespace lava::format::legacy
 	template<> // fill the string to specified width
 	struct format_trait<fill_t>
 	{
-		static void format_append(std::string& res, fill_t&& f)
+		template<typename Sink>
+		static void format_append(Sink& res, const fill_t& f)
 		{
-			const int l = (int) f.content.length();
-			if (f.width <= l)
-			{
-				res.append(f.content);
-				return;
-			}
+			const auto [l_cnt, r_cnt] = detail::padding(display_width(f.content), f.width, f.align);
+			detail::pad(res, f.to_fill, l_cnt);
+			res.append(f.content.data(), f.content.size());
+			detail::pad(res, f.to_fill, r_cnt);
+		}
+		static size_t formatted_size(const fill_t& f)
+		{
+			const auto [l_cnt, r_cnt] = detail::padding(display_width(f.content), f.width, f.align);
+			return l_cnt + f.content.size() + r_cnt;
+		}
+	};
 
-			res.reserve(res.length() + f.width);
+	// align the contents and fill the blank, formatting the contents only when needed
+	// lvalue contents are held by reference, so keep them alive until formatted
+	// rvalue contents are moved into the wrapper
+	template<typename... Us>
+	struct aligned
+	{
+		std::tuple<Us...> contents;
+		int width;
+		alignment align;
+		char to_fill;
 
-			int l_cnt{0}, r_cnt{0};
-			const int delta = f.width - l;
-			if (f.align == alignment::left)
-				r_cnt = delta;
-			else if (f.align == alignment::right)
-				l_cnt = delta;
+		// format the contents eagerly, for code expecting a `fill_t`
+		operator fill_t() const
+		{
+			return {std::apply([](const auto&... xs) { return format(xs...); }, contents), width, align, to_fill};
+		}
+	};
+	template<typename... Us> // fill the contents to specified width
+	struct format_trait<aligned<Us...>>
+	{
+		using U = aligned<Us...>;
+		template<typename Sink>
+		static void format_append(Sink& res, const U& f)
+		{
+			const auto write = [&res](const auto&... xs) { format_to(res, xs...); };
+			if constexpr (std::is_same_v<Sink, std::string>)
+			{
+				// format in place, then shift the text right for the leading fill
+				const size_t start = res.size();
+				std::apply(write, f.contents);
+				const auto [l_cnt, r_cnt] = detail::padding(display_width(std::string_view{res}.substr(start)), f.width, f.align);
+				res.insert(start, l_cnt, f.to_fill);
+				res.append(r_cnt, f.to_fill);
+			}
+			else if constexpr ((has_view<std::decay_t<Us>>::value && ...))
+			{
+				// measured on their text, then written as-is
+				const auto [l_cnt, r_cnt] = detail::padding(columns(f), f.width, f.align);
+				detail::pad(res, f.to_fill, l_cnt);
+				std::apply(write, f.contents);
+				detail::pad(res, f.to_fill, r_cnt);
+			}
 			else
 			{
-				l_cnt = delta / 2;
-				r_cnt = (delta + 1) / 2;
+				// formatted once to a scratch buffer, measured, then written
+				scoped_buffer text{};
+				std::apply([&text](const auto&... xs) { format_s(text.str(), xs...); }, f.contents);
+				const auto [l_cnt, r_cnt] = detail::padding(display_width(text.view()), f.width, f.align);
+				detail::pad(res, f.to_fill, l_cnt);
+				res.append(text.str().data(), text.size());
+				detail::pad(res, f.to_fill, r_cnt);
 			}
+		}
+		static size_t formatted_size(const U& f)
+		{
+			const size_t n = std::apply([](const auto&... xs) { return legacy::formatted_size(xs...); }, f.contents);
+			return n + static_cast<size_t>(std::max(f.width, 0));
+		}
 
-			for (int i{0}; i < l_cnt; ++i)
-				res.push_back(f.to_fill);
-			res.append(f.content);
-			for (int i{0}; i < r_cnt; ++i)
-				res.push_back(f.to_fill);
+	private:
+		// the display width of the contents, all of which expose their text
+		static size_t columns(const U& f)
+		{
+			return std::apply(
+				[](const auto&... xs) {
+					return (size_t{0} + ... + display_width(format_trait<std::decay_t<decltype(xs)>>::view(xs)));
+				},
+				f.contents);
 		}
 	};
 
-#define DEFINE_ALIGNMENT(align, name)                                    \
-	template<typename... Us>                                             \
-	inline fill_t name(int width, Us&&... xs)                            \
-	{                                                                    \
-		return {format(std::forward<Us>(xs)...), width, align, ' '};     \
-	}                                                                    \
-	template<typename... Us>                                             \
-	inline fill_t name##_fill(int width, char to_fill, Us&&... xs)       \
-	{                                                                    \
-		return {format(std::forward<Us>(xs)...), width, align, to_fill}; \
+#define DEFINE_ALIGNMENT(align, name)                                            \
+	template<typename... Us>                                                     \
+	inline aligned<Us...> name(int width, Us&&... xs)                            \
+	{                                                                            \
+		return {std::tuple<Us...>{std::forward<Us>(xs)...}, width, align, ' '};  \
+	}                                                                            \
+	template<typename... Us>                                                     \
+	inline aligned<Us...> name##_fill(int width, char to_fill, Us&&... xs)       \
+	{                                                                            \
+		return {std::tuple<Us...>{std::forward<Us>(xs)...}, width, align, to_fill}; \
 	}
 	// define all three shortcut functions
 	DEFINE_ALIGNMENT(alignment::left, left)
 	DEFINE_ALIGNMENT(alignment::right, right)
 	DEFINE_ALIGNMENT(alignment::center, center)
 #undef DEFINE_ALIGNMENT
-} // namespace lava::format::legacy
\ No newline at end of file
+} // namespace lava::format::legacy
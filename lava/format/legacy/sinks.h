@@ -0,0 +1,294 @@
+#pragma once
+#include "basic.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<unistd.h>)
+#	include <unistd.h>
+#	define LAVA_FORMAT_HAS_FD_SINK
+#	if __has_include(<sys/uio.h>)
+#		include <climits>
+#		include <sys/uio.h>
+#		define LAVA_FORMAT_HAS_GATHER_SINK
+#	endif
+#endif
+
+namespace lava::format::legacy
+{
+	// sink: count the characters only, nothing is written
+	class counting_sink
+	{
+	public:
+		void push_back(char) noexcept { ++count; }
+		void append(const char*, size_t n) noexcept { count += n; }
+		size_t size() const noexcept { return count; }
+
+	private:
+		size_t count{0};
+	};
+
+	// sink: a caller-provided buffer of fixed size
+	// text beyond the buffer is dropped, but still counted
+	class buffer_sink
+	{
+	public:
+		buffer_sink(char* out, size_t n) noexcept
+			: out{out}
+			, last{out + n}
+		{}
+		void push_back(char c) noexcept
+		{
+			if (out != last)
+				*out++ = c;
+			++count;
+		}
+		void append(const char* s, size_t n) noexcept
+		{
+			const size_t m = std::min(n, static_cast<size_t>(last - out));
+			if (m != 0)
+				std::memcpy(out, s, m);
+			out += m;
+			count += n;
+		}
+		// past the last character written
+		char* end() const noexcept { return out; }
+		// the length of the whole text, including the dropped part
+		size_t size() const noexcept { return count; }
+
+	private:
+		char* out;
+		char* last;
+		size_t count{0};
+	};
+
+	struct format_to_n_result
+	{
+		char* out;   // past the last character written
+		size_t size; // the length of the whole text, without truncation
+	};
+
+	// format_to_n: format all the parameters to `out`, writing at most `n` characters
+	// the text is truncated if it does not fit, and no NUL terminator is added
+	template<typename... Us>
+	inline format_to_n_result format_to_n(char* out, size_t n, Us&&... xs)
+	{
+		buffer_sink sink{out, n};
+		format_to(sink, std::forward<Us>(xs)...);
+		return {sink.end(), sink.size()};
+	}
+
+	// writer for buffered_sink: a C stream
+	struct file_writer
+	{
+		std::FILE* file;
+		bool operator()(const char* s, size_t n) const
+		{
+			return std::fwrite(s, 1, n, file) == n;
+		}
+	};
+	// sink: a C stream, written in bounded chunks with fwrite
+	using file_sink = buffered_sink<file_writer>;
+
+	// format_file: format all the parameters to C stream `file`
+	// return whether all the text is written
+	template<typename... Us>
+	inline bool format_file(std::FILE* file, Us&&... xs)
+	{
+		const detail::destination_scope destination{detail::file_fd(file)};
+		file_sink sink{file};
+		format_to(sink, std::forward<Us>(xs)...);
+		sink.flush();
+		return sink.good();
+	}
+
+#ifdef LAVA_FORMAT_HAS_FD_SINK
+	// writer for buffered_sink: a POSIX file descriptor
+	// only write(2) is used, so it is async-signal-safe
+	struct fd_writer
+	{
+		int fd;
+		bool operator()(const char* s, size_t n) const noexcept
+		{
+			const int saved_errno = errno;
+			bool ok = true;
+			while (n != 0)
+			{
+				const ssize_t r = ::write(fd, s, n);
+				if (r < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					ok = false;
+					break;
+				}
+				s += r;
+				n -= static_cast<size_t>(r);
+			}
+			errno = saved_errno;
+			return ok;
+		}
+	};
+	// sink: a POSIX file descriptor, written in bounded chunks with no allocation
+	using fd_sink = buffered_sink<fd_writer>;
+
+	// format_fd: format all the parameters to file descriptor `fd`
+	// return whether all the text is written
+	// with traits that do not allocate, this is safe to use in signal handlers
+	template<typename... Us>
+	inline bool format_fd(int fd, Us&&... xs)
+	{
+		const detail::destination_scope destination{fd};
+		fd_sink sink{fd};
+		format_to(sink, std::forward<Us>(xs)...);
+		sink.flush();
+		return sink.good();
+	}
+#endif
+
+#ifdef LAVA_FORMAT_HAS_GATHER_SINK
+	// sink: a POSIX file descriptor, written with a single writev(2) for all the segments
+	// pieces appended are copied to a scratch buffer; texts lent with `borrow` are only referenced,
+	// and must stay alive until the sink is flushed
+	class gather_sink
+	{
+	public:
+		// texts shorter than this are copied, they are cheaper to copy than to write as segments
+		static constexpr size_t borrow_threshold = 128;
+		// the segments pending at most, they are written once there are as many
+		static constexpr size_t max_segments = 64;
+
+		explicit gather_sink(int fd) noexcept
+			: fd{fd}
+		{}
+		~gather_sink() { flush(); }
+		gather_sink(const gather_sink&) = delete;
+		gather_sink& operator=(const gather_sink&) = delete;
+
+		void push_back(char c) { append(&c, 1); }
+		void append(const char* s, size_t n)
+		{
+			if (n == 0)
+				return;
+			// consecutive pieces share the segment at the end of the scratch buffer
+			if (count == 0 || segments[count - 1].data != nullptr)
+			{
+				reserve_segment();
+				segments[count++] = {nullptr, scratch.size(), 0};
+			}
+			scratch.append(s, n);
+			segments[count - 1].size += n;
+		}
+		// reference `n` characters at `s`, without copying them
+		void borrow(const char* s, size_t n)
+		{
+			if (n < borrow_threshold)
+				append(s, n);
+			else
+			{
+				reserve_segment();
+				segments[count++] = {s, 0, n};
+			}
+		}
+		// write all the segments pending
+		void flush()
+		{
+			if (count != 0)
+				write();
+			count = 0;
+			scratch.str().clear();
+		}
+		// whether all the writes so far succeeded
+		bool good() const noexcept { return ok; }
+
+	private:
+		// borrowed text at `data`, or the scratch buffer from `offset`
+		struct segment
+		{
+			const char* data;
+			size_t offset;
+			size_t size;
+		};
+
+		void reserve_segment()
+		{
+			if (count == max_segments)
+				flush();
+		}
+
+		void write() noexcept
+		{
+			if (!ok)
+				return;
+			iovec iov[max_segments];
+			for (size_t i = 0; i != count; ++i)
+			{
+				const char* s = segments[i].data != nullptr ? segments[i].data : scratch.str().data() + segments[i].offset;
+				iov[i] = {const_cast<char*>(s), segments[i].size};
+			}
+			const int saved_errno = errno;
+			for (iovec *p = iov, *last = iov + count; p != last;)
+			{
+				const ssize_t r = ::writev(fd, p, static_cast<int>(std::min<ptrdiff_t>(last - p, IOV_MAX)));
+				if (r < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					ok = false;
+					break;
+				}
+				// skip the segments written, then the written part of the next one
+				auto n = static_cast<size_t>(r);
+				for (; p != last && n >= p->iov_len; ++p)
+					n -= p->iov_len;
+				if (n != 0)
+				{
+					p->iov_base = static_cast<char*>(p->iov_base) + n;
+					p->iov_len -= n;
+				}
+			}
+			errno = saved_errno;
+		}
+
+		int fd;
+		bool ok{true};
+		size_t count{0};
+		segment segments[max_segments];
+		scoped_buffer scratch{};
+	};
+
+	namespace detail
+	{
+		// lend the text of `x` to the sink if its trait exposes it as-is, format it otherwise
+		// only the parameters themselves are lent: they outlive the call, unlike what traits format internally
+		template<typename U>
+		inline void gather_one(gather_sink& res, U&& x)
+		{
+			using T = std::decay_t<U>;
+			if constexpr (has_view<T>::value)
+			{
+				const std::string_view s = format_trait<T>::view(x);
+				res.borrow(s.data(), s.size());
+			}
+			else
+				format_one(res, std::forward<U>(x));
+		}
+	} // namespace detail
+
+	// format_gather: format all the parameters to file descriptor `fd`, with a single writev(2)
+	// large texts (std::string, std::string_view, C strings...) are written from where they are, not copied
+	// return whether all the text is written
+	template<typename... Us>
+	inline bool format_gather(int fd, Us&&... xs)
+	{
+		const detail::destination_scope destination{fd};
+		gather_sink sink{fd};
+		(detail::gather_one(sink, std::forward<Us>(xs)), ...);
+		sink.flush();
+		return sink.good();
+	}
+#endif
+} // namespace lava::format::legacy
@@ -0,0 +1,268 @@
+#pragma once
+#include "ansi.h"
+#include "basic.h"
+#include "buffer.h"
+#include "containers.h"
+#include "meta.h"
+#include "utf.h"
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lava::format::legacy
+{
+	// a table: rows of cells, aligned in columns as wide as their widest cell
+	// a row is a range of cells (e.g. std::vector<std::string>), or a std::tuple of them
+	// the header, if any, is a row written in `header_style`
+	template<typename Rows, typename Header = std::tuple<>>
+	struct table_t
+	{
+		const Rows& rows;
+		const Header* header;
+		std::string_view align;     // per column: '<' left, '>' right, '^' center, left if absent
+		std::string_view separator; // between the columns
+		ansi header_style;
+	};
+
+	template<typename Rows>
+	inline table_t<Rows> table(const Rows& rows, std::string_view align = {}, std::string_view separator = "  ")
+	{
+		return {rows, nullptr, align, separator, Intense};
+	}
+	template<typename Header, typename Rows>
+	inline table_t<Rows, Header> table_with_header(
+		const Header& header, const Rows& rows, std::string_view align = {}, std::string_view separator = "  ")
+	{
+		return {rows, &header, align, separator, Intense};
+	}
+
+	namespace detail
+	{
+		template<typename T>
+		struct is_tuple : std::false_type
+		{};
+		template<typename... Ts>
+		struct is_tuple<std::tuple<Ts...>> : std::true_type
+		{};
+		template<typename T, typename U>
+		struct is_tuple<std::pair<T, U>> : std::true_type
+		{};
+
+		// whether the cells of `Row` are lvalues, which live as long as the row: the elements of a tuple,
+		// or of a range whose iterators yield references (a generator yields temporaries)
+		template<typename Row, typename = void>
+		struct yields_lvalues : std::true_type
+		{};
+		template<typename Row>
+		struct yields_lvalues<Row, std::enable_if_t<!is_tuple<Row>::value>>
+			: std::is_lvalue_reference<decltype(*std::begin(std::declval<const Row&>()))>
+		{};
+
+		// call `f` on each cell of `row`
+		template<typename Row, typename F>
+		inline void for_each_cell(const Row& row, F&& f)
+		{
+			if constexpr (is_tuple<Row>::value)
+				std::apply([&f](const auto&... xs) { (f(xs), ...); }, row);
+			else
+				for (const auto& x : row)
+					f(x);
+		}
+
+		// sink: memory reserved beforehand, written with no bound check
+		struct unchecked_sink
+		{
+			char* out;
+			void push_back(char c) noexcept { *out++ = c; }
+			void append(const char* s, size_t n) noexcept
+			{
+				std::memcpy(out, s, n);
+				out += n;
+			}
+		};
+
+		inline void pad(unchecked_sink& res, char c, size_t n) noexcept
+		{
+			std::memset(res.out, c, n);
+			res.out += n;
+		}
+
+		// a cell measured: its text as-is, or formatted to the scratch buffer at `offset`
+		// a cell is kept as-is only if it lives until the table is written, it is copied otherwise
+		struct table_cell
+		{
+			const char* data;
+			size_t offset;
+			size_t size;
+			size_t width;
+		};
+
+		// the cells measured, each formatted once, and the width of each column
+		class table_layout
+		{
+		public:
+			// `lasting`: whether `row` lives until the table is written
+			template<bool lasting, typename Row>
+			void add_row(const Row& row)
+			{
+				size_t column = 0;
+				for_each_cell(row, [this, &column](const auto& x) {
+					using T = std::decay_t<decltype(x)>;
+					table_cell c{};
+					if constexpr (lasting && yields_lvalues<Row>::value && has_view<T>::value)
+					{
+						const std::string_view s = format_trait<T>::view(x);
+						c.data = s.data();
+						c.size = s.size();
+					}
+					else
+					{
+						c.offset = scratch.size();
+						format_to(scratch, x);
+						c.size = scratch.size() - c.offset;
+					}
+					c.width = display_width(text(c));
+					if (column == widths.size())
+						widths.push_back(c.width);
+					else if (c.width > widths[column])
+						widths[column] = c.width;
+					cells.push_back(c);
+					++column;
+				});
+				row_ends.push_back(cells.size());
+			}
+
+			// make room for `rows` rows as wide as the last one
+			void reserve(size_t rows)
+			{
+				const size_t columns = row_ends.empty() ? 0 : row_ends.back() - (row_ends.size() == 1 ? 0 : row_ends[row_ends.size() - 2]);
+				cells.reserve(cells.size() + rows * columns);
+				row_ends.reserve(row_ends.size() + rows);
+			}
+
+			// the fill before and after the cell in `column`, no trailing blank at the end of a row
+			std::pair<size_t, size_t> padding(const table_cell& c, size_t column, bool last, std::string_view align) const
+			{
+				const char a = column < align.size() ? align[column] : '<';
+				const alignment how = a == '>' ? alignment::right : a == '^' ? alignment::center : alignment::left;
+				auto p = detail::padding(c.width, static_cast<int>(widths[column]), how);
+				if (last)
+					p.second = 0;
+				return p;
+			}
+
+			// the length of the table written, with `decoration` characters on each header row
+			size_t size(size_t header_rows, size_t decoration, std::string_view align, std::string_view separator) const
+			{
+				size_t n = header_rows * decoration;
+				for_each_row([&](size_t row, size_t first, size_t last) {
+					static_cast<void>(row);
+					n += 1 + (last - first - (last != first)) * separator.size();
+					for (size_t i = first; i != last; ++i)
+					{
+						const auto [l_cnt, r_cnt] = padding(cells[i], i - first, i + 1 == last, align);
+						n += l_cnt + cells[i].size + r_cnt;
+					}
+				});
+				return n;
+			}
+
+			template<typename Sink>
+			void write(Sink& res, size_t header_rows, std::string_view begin_header, std::string_view end_header,
+					   std::string_view align, std::string_view separator) const
+			{
+				for_each_row([&](size_t row, size_t first, size_t last) {
+					if (row < header_rows)
+						res.append(begin_header.data(), begin_header.size());
+					for (size_t i = first; i != last; ++i)
+					{
+						if (i != first)
+							res.append(separator.data(), separator.size());
+						const auto [l_cnt, r_cnt] = padding(cells[i], i - first, i + 1 == last, align);
+						const std::string_view s = text(cells[i]);
+						detail::pad(res, ' ', l_cnt);
+						res.append(s.data(), s.size());
+						detail::pad(res, ' ', r_cnt);
+					}
+					if (row < header_rows)
+						res.append(end_header.data(), end_header.size());
+					res.push_back('\n');
+				});
+			}
+
+		private:
+			std::string_view text(const table_cell& c) const
+			{
+				if (c.data != nullptr)
+					return {c.data, c.size};
+				return scratch.view().substr(c.offset, c.size);
+			}
+
+			template<typename F>
+			void for_each_row(F&& f) const
+			{
+				size_t first = 0;
+				for (size_t row = 0; row != row_ends.size(); ++row)
+				{
+					f(row, first, row_ends[row]);
+					first = row_ends[row];
+				}
+			}
+
+			std::vector<table_cell> cells;
+			std::vector<size_t> row_ends;
+			std::vector<size_t> widths;
+			scoped_buffer scratch;
+		};
+	} // namespace detail
+
+	// format a table in a single pass over the rows: each cell is formatted once, to measure it,
+	// then the table is written, to a string reserved to its exact size
+	// no formatted_size: the size is only known once the cells are measured
+	template<typename Rows, typename Header>
+	struct format_trait<table_t<Rows, Header>>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, const table_t<Rows, Header>& t)
+		{
+			detail::table_layout layout;
+			size_t header_rows = 0;
+			if (t.header != nullptr)
+			{
+				layout.add_row<true>(*t.header);
+				header_rows = 1;
+			}
+			auto p = std::cbegin(t.rows);
+			const auto pend = std::cend(t.rows);
+			// rows yielded as temporaries do not live until the table is written
+			constexpr bool lasting = std::is_lvalue_reference_v<decltype(*p)>;
+			if (p != pend)
+			{
+				layout.add_row<lasting>(*p);
+				if constexpr (has_size<Rows>::value)
+					layout.reserve(std::size(t.rows) - 1);
+				for (++p; p != pend; ++p)
+					layout.add_row<lasting>(*p);
+			}
+
+			const std::string_view begin_header = format_trait<ansi>::view(t.header_style);
+			const std::string_view end_header = begin_header.empty() ? std::string_view{} : format_trait<ansi>::view(Reset);
+			if constexpr (std::is_same_v<Sink, std::string>)
+			{
+				// the size is exact: write to the string directly
+				const size_t start = res.size();
+				const size_t n = layout.size(header_rows, begin_header.size() + end_header.size(), t.align, t.separator);
+				detail::reserve_append(res, n);
+				res.resize(start + n);
+				detail::unchecked_sink out{res.data() + start};
+				layout.write(out, header_rows, begin_header, end_header, t.align, t.separator);
+			}
+			else
+				layout.write(res, header_rows, begin_header, end_header, t.align, t.separator);
+		}
+	};
+} // namespace lava::format::legacy
@@ -1,7 +1,9 @@
 #pragma once
 #include "basic.h"
+#include "escape.h"
 #include "integers.h"
 #include "meta.h"
+#include "utf.h"
 #include <string>
 
 namespace lava::format::legacy
@@ -9,60 +11,65 @@ namespace lava::format::legacy
 	template<> // format a single character
 	struct format_trait<char>
 	{
-		static void format_append(std::string& res, char c) { res.push_back(c); }
+		template<typename Sink>
+		static void format_append(Sink& res, char c) { res.push_back(c); }
+		static constexpr size_t max_length = 1;
+		static constexpr size_t formatted_size(char) { return max_length; }
 	};
 
 	template<> // format a C-style NUL-terminated string
 	struct format_trait<const char*>
 	{
-		static void format_append(std::string& res, const char* s) { res.append(s); }
+		template<typename Sink>
+		static void format_append(Sink& res, const char* s) { res.append(s, std::char_traits<char>::length(s)); }
+		static size_t formatted_size(const char* s) { return std::char_traits<char>::length(s); }
+		static std::string_view view(const char* s) { return s; }
 	};
 
 	template<> // format a non-const C-style NUL-terminated string
 	struct format_trait<char*>
 	{
-		static void format_append(std::string& res, const char* s) { res.append(s); }
+		template<typename Sink>
+		static void format_append(Sink& res, const char* s) { res.append(s, std::char_traits<char>::length(s)); }
+		static size_t formatted_size(const char* s) { return std::char_traits<char>::length(s); }
+		static std::string_view view(const char* s) { return s; }
 	};
 
 	template<> // format a C++ std::string
 	struct format_trait<std::string>
 	{
-		static void format_append(std::string& res, const std::string& s) { res.append(s); }
+		template<typename Sink>
+		static void format_append(Sink& res, const std::string& s) { res.append(s.data(), s.size()); }
+		static size_t formatted_size(const std::string& s) { return s.size(); }
+		static std::string_view view(const std::string& s) { return s; }
 	};
 
 	template<> // format a C++ std::string_view
 	struct format_trait<std::string_view>
 	{
-		static void format_append(std::string& res, const std::string_view& s) { res.append(s); }
+		template<typename Sink>
+		static void format_append(Sink& res, const std::string_view& s) { res.append(s.data(), s.size()); }
+		static size_t formatted_size(const std::string_view& s) { return s.size(); }
+		static std::string_view view(const std::string_view& s) { return s; }
 	};
 
-	template<typename T>
-	void to_literal(T c, std::string& res)
+	template<typename T, typename Sink>
+	void to_literal(T c, Sink& res)
 	{
-		if (c == '\a')
-			res.append("\\a");
-		else if (c == '\b')
-			res.append("\\b");
-		else if (c == '\f')
-			res.append("\\f");
-		else if (c == '\n')
-			res.append("\\n");
-		else if (c == '\r')
-			res.append("\\r");
-		else if (c == '\t')
-			res.append("\\t");
-		else if (c == '\v')
-			res.append("\\v");
-		else if (c == '\\')
-			res.append("\\\\");
-		else if (c == '\'')
-			res.append("\\'");
-		else if (c == '\"')
-			res.append("\\\"");
-		else if (c == '\0')
-			res.append("\\0");
+		const auto u = static_cast<std::make_unsigned_t<T>>(c);
+		if (u < 256 && detail::escape_table[u] != 0)
+		{
+			const char escaped[2] = {'\\', detail::escape_table[u]};
+			res.append(escaped, 2);
+		}
+		else if (sizeof(T) == 1 || u < 0x80)
+			res.push_back(static_cast<char>(c));
 		else
-			res.push_back(c);
+		{
+			// UTF-16 and UTF-32 characters are encoded as UTF-8
+			char buffer[4];
+			res.append(buffer, detail::encode_utf8(static_cast<char32_t>(u), buffer));
+		}
 	}
 
 	template<typename T>
@@ -97,41 +104,61 @@ namespace lava::format::legacy
 	template<typename C, size_t N>
 	literal(const C (&)[N])->literal<std::basic_string<C>>;
 
+	namespace detail
+	{
+		// the longest text of a character in a literal: an escape, or a UTF-8 sequence
+		template<typename T>
+		constexpr size_t literal_size = sizeof(T) == 1 ? 2 : sizeof(T) == 2 ? 3 : 4;
+	} // namespace detail
+
 	template<typename T>
 	struct format_trait<literal<T>>
 	{
-		static std::enable_if_t<is_char<T>> format_append(std::string& res, literal<T> c)
+		template<typename Sink>
+		static std::enable_if_t<is_char<T>> format_append(Sink& res, literal<T> c)
 		{
 			res.push_back('\'');
 			to_literal(c.text, res);
 			res.push_back('\'');
 		}
+		// each character is escaped or encoded to at most `literal_size` characters
+		static constexpr size_t formatted_size(literal<T>) { return detail::literal_size<T> + 2; }
 	};
 
 	template<typename T>
 	struct format_trait<literal<std::basic_string<T>>>
 	{
 		using str = literal<std::basic_string<T>>;
-		static std::enable_if_t<is_char<T>> format_append(std::string& res, const str& s)
+		template<typename Sink>
+		static std::enable_if_t<is_char<T>> format_append(Sink& res, const str& s)
 		{
 			res.push_back('"');
-			for (auto c : s.text)
-				to_literal(c, res);
+			if constexpr (std::is_same_v<T, char>)
+				detail::escape_to(res, s.text.data(), s.text.size());
+			else
+				for (size_t i = 0; i != s.text.size();)
+					to_literal(detail::next_code_point(s.text.data(), s.text.size(), i), res);
 			res.push_back('"');
 		}
+		static size_t formatted_size(const str& s) { return detail::literal_size<T> * s.text.size() + 2; }
 	};
 
 	template<typename T>
 	struct format_trait<literal<std::basic_string_view<T>>>
 	{
 		using str = literal<std::basic_string_view<T>>;
-		static std::enable_if_t<is_char<T>> format_append(std::string& res, str s)
+		template<typename Sink>
+		static std::enable_if_t<is_char<T>> format_append(Sink& res, str s)
 		{
 			res.push_back('"');
-			for (auto c : s.text)
-				to_literal(c, res);
+			if constexpr (std::is_same_v<T, char>)
+				detail::escape_to(res, s.text.data(), s.text.size());
+			else
+				for (size_t i = 0; i != s.text.size();)
+					to_literal(detail::next_code_point(s.text.data(), s.text.size(), i), res);
 			res.push_back('"');
 		}
+		static size_t formatted_size(str s) { return detail::literal_size<T> * s.text.size() + 2; }
 	};
 
 	// format structure for a unicode character
@@ -148,11 +175,14 @@ namespace lava::format::legacy
 	struct format_trait<unicode>
 	{
 #define UCHAR_FORMAT_SEQ(uc) \
-	"U+", right(4, '0', hexadecimal(uint32_t(uc))), '[', decimal(uint32_t(uc)), ']'
-		static void format_append(std::string& res, unicode c)
+	"U+", right_fill(4, '0', hexadecimal(uint32_t(uc))), '[', decimal(uint32_t(uc)), ']'
+		template<typename Sink>
+		static void format_append(Sink& res, unicode c)
 		{
-			format_s(res, UCHAR_FORMAT_SEQ(c.value));
+			format_to(res, UCHAR_FORMAT_SEQ(c.value));
 		}
+		// "U+", up to 8 hexadecimal digits, '[', up to 10 decimal digits, ']'
+		static constexpr size_t formatted_size(unicode) { return 2 + 8 + 1 + 10 + 1; }
 #undef UCHAR_FORMAT_SEQ
 	};
 } // namespace lava::format::legacy
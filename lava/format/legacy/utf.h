@@ -0,0 +1,387 @@
+#pragma once
+#include "basic.h"
+#include "escape.h"
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Unicode: UTF-16/UTF-32 to UTF-8 transcoding, UTF-8 validation and display widths
+// all of them run over ASCII text in bulk, and decode code points only elsewhere
+namespace lava::format::legacy
+{
+	namespace detail
+	{
+		constexpr char32_t replacement_character = 0xFFFD;
+
+		// encode the code point `c` to `out`, which has room for 4 characters
+		// return the count of characters written
+		inline size_t encode_utf8(char32_t c, char* out) noexcept
+		{
+			if (c >= 0xD800 && (c <= 0xDFFF || c > 0x10FFFF))
+				c = replacement_character;
+			if (c < 0x80)
+			{
+				out[0] = static_cast<char>(c);
+				return 1;
+			}
+			if (c < 0x800)
+			{
+				out[0] = static_cast<char>(0xC0 | (c >> 6));
+				out[1] = static_cast<char>(0x80 | (c & 0x3F));
+				return 2;
+			}
+			if (c < 0x10000)
+			{
+				out[0] = static_cast<char>(0xE0 | (c >> 12));
+				out[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				out[2] = static_cast<char>(0x80 | (c & 0x3F));
+				return 3;
+			}
+			out[0] = static_cast<char>(0xF0 | (c >> 18));
+			out[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+			out[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			out[3] = static_cast<char>(0x80 | (c & 0x3F));
+			return 4;
+		}
+
+		// the count of leading ASCII characters in [s, s + n)
+		inline size_t ascii_prefix(const char* s, size_t n) noexcept
+		{
+			size_t i = 0;
+#ifdef LAVA_FORMAT_HAS_SSE2
+			for (; i + 16 <= n; i += 16)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+				if (const int mask = _mm_movemask_epi8(v))
+					return i + lowest_bit(static_cast<unsigned>(mask));
+			}
+#endif
+			while (i != n && static_cast<unsigned char>(s[i]) < 0x80)
+				++i;
+			return i;
+		}
+		inline size_t ascii_prefix(const char16_t* s, size_t n) noexcept
+		{
+			size_t i = 0;
+#ifdef LAVA_FORMAT_HAS_SSE2
+			const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+			for (; i + 8 <= n; i += 8)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+				const __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(v, high), _mm_setzero_si128());
+				if (const int mask = _mm_movemask_epi8(ascii) ^ 0xFFFF)
+					return i + lowest_bit(static_cast<unsigned>(mask)) / 2;
+			}
+#endif
+			while (i != n && s[i] < 0x80)
+				++i;
+			return i;
+		}
+		inline size_t ascii_prefix(const char32_t* s, size_t n) noexcept
+		{
+			size_t i = 0;
+#ifdef LAVA_FORMAT_HAS_SSE2
+			const __m128i high = _mm_set1_epi32(~0x7F);
+			for (; i + 4 <= n; i += 4)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+				const __m128i ascii = _mm_cmpeq_epi32(_mm_and_si128(v, high), _mm_setzero_si128());
+				if (const int mask = _mm_movemask_epi8(ascii) ^ 0xFFFF)
+					return i + lowest_bit(static_cast<unsigned>(mask)) / 4;
+			}
+#endif
+			while (i != n && s[i] < 0x80)
+				++i;
+			return i;
+		}
+
+		// decode the code point at `s[i]`, advancing `i` past it
+		// unpaired surrogates and values out of range decode to U+FFFD
+		inline char32_t next_code_point(const char16_t* s, size_t n, size_t& i) noexcept
+		{
+			const char32_t c = s[i++];
+			if (c < 0xD800 || c > 0xDFFF)
+				return c;
+			if (c <= 0xDBFF && i != n && s[i] >= 0xDC00 && s[i] <= 0xDFFF)
+				return 0x10000 + ((c - 0xD800) << 10) + (s[i++] - 0xDC00);
+			return replacement_character;
+		}
+		inline char32_t next_code_point(const char32_t* s, size_t, size_t& i) noexcept
+		{
+			const char32_t c = s[i++];
+			return (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF ? replacement_character : c;
+		}
+
+		// decode the UTF-8 sequence at the start of [s, s + n) to `c`
+		// return its length, or 0 if it is malformed (overlong, surrogate, out of range, truncated)
+		inline size_t decode_utf8(const char* s, size_t n, char32_t& c) noexcept
+		{
+			const auto byte = [s](size_t k) { return static_cast<unsigned char>(s[k]); };
+			const unsigned char b = byte(0);
+			size_t len = 0;
+			char32_t min = 0;
+			if (b < 0x80)
+			{
+				c = b;
+				return 1;
+			}
+			else if (b >= 0xC2 && b <= 0xDF)
+				len = 2, c = b & 0x1F, min = 0x80;
+			else if (b >= 0xE0 && b <= 0xEF)
+				len = 3, c = b & 0x0F, min = 0x800;
+			else if (b >= 0xF0 && b <= 0xF4)
+				len = 4, c = b & 0x07, min = 0x10000;
+			else
+				return 0;
+			if (n < len)
+				return 0;
+			for (size_t k = 1; k != len; ++k)
+			{
+				if ((byte(k) & 0xC0) != 0x80)
+					return 0;
+				c = c << 6 | (byte(k) & 0x3F);
+			}
+			if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+				return 0;
+			return len;
+		}
+
+		// transcode UTF-16 or UTF-32 text to UTF-8, appending to `res`
+		// ASCII runs are narrowed in bulk through a stack buffer
+		template<typename Sink, typename C>
+		inline void transcode_to(Sink& res, const C* s, size_t n)
+		{
+			char buffer[256];
+			size_t used = 0;
+			for (size_t i = 0; i != n;)
+			{
+				// keep room for a UTF-8 sequence after the ASCII run
+				if (sizeof(buffer) - used <= 4)
+				{
+					res.append(buffer, used);
+					used = 0;
+				}
+				const size_t k = ascii_prefix(s + i, std::min(n - i, sizeof(buffer) - 4 - used));
+				for (size_t j = 0; j != k; ++j)
+					buffer[used + j] = static_cast<char>(s[i + j]);
+				used += k;
+				i += k;
+				if (i != n && s[i] >= 0x80)
+					used += encode_utf8(next_code_point(s, n, i), buffer + used);
+			}
+			if (used != 0)
+				res.append(buffer, used);
+		}
+
+		// code points taking 2 columns: East Asian Wide (W) and Fullwidth (F)
+		inline constexpr char32_t wide_ranges[][2] = {
+			{0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0},
+			{0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F},
+			{0x2693, 0x2693}, {0x26A1, 0x26A1}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5},
+			{0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+			{0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728},
+			{0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+			{0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55},
+			{0x2E80, 0x303E}, {0x3041, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+			{0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6F},
+			{0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4}, {0x17000, 0x18CFF}, {0x1B000, 0x1B2FF},
+			{0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251},
+			{0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF}, {0x1F900, 0x1F9FF}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+		};
+		// code points taking no column: combining marks, zero-width spaces and joiners, variation selectors
+		inline constexpr char32_t zero_width_ranges[][2] = {
+			{0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x0610, 0x061A}, {0x064B, 0x065F},
+			{0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x20D0, 0x20FF}, {0xFE00, 0xFE0F},
+			{0xFE20, 0xFE2F}, {0xE0100, 0xE01EF},
+		};
+
+		template<size_t N>
+		constexpr bool in_ranges(char32_t c, const char32_t (&ranges)[N][2]) noexcept
+		{
+			size_t lo = 0, hi = N;
+			while (lo < hi)
+			{
+				const size_t mid = (lo + hi) / 2;
+				if (c < ranges[mid][0])
+					hi = mid;
+				else if (c > ranges[mid][1])
+					lo = mid + 1;
+				else
+					return true;
+			}
+			return false;
+		}
+
+		// the count of columns the code point `c` takes on a terminal
+		constexpr size_t column_width(char32_t c) noexcept
+		{
+			if (c < 0x300)
+				return 1;
+			if (in_ranges(c, zero_width_ranges))
+				return 0;
+			return in_ranges(c, wide_ranges) ? 2 : 1;
+		}
+	} // namespace detail
+
+	// whether [s, s + n) is well-formed UTF-8
+	inline bool is_valid_utf8(const char* s, size_t n) noexcept
+	{
+		for (size_t i = 0; i != n;)
+		{
+			i += detail::ascii_prefix(s + i, n - i);
+			if (i == n)
+				break;
+			char32_t c = 0;
+			const size_t k = detail::decode_utf8(s + i, n - i, c);
+			if (k == 0)
+				return false;
+			i += k;
+		}
+		return true;
+	}
+	inline bool is_valid_utf8(std::string_view s) noexcept { return is_valid_utf8(s.data(), s.size()); }
+
+	// sink: measure the display width of UTF-8 text, nothing is written
+	// wide characters take 2 columns, combining marks none, and malformed bytes 1 each
+	// ANSI escape sequences (ESC '[' ... final byte) take no column
+	class width_sink
+	{
+	public:
+		void push_back(char c) noexcept { append(&c, 1); }
+		void append(const char* s, size_t n) noexcept
+		{
+			for (size_t i = 0; i != n;)
+			{
+				if (pending == 0 && escape == 0)
+				{
+					// the fast path: ASCII text with no escape sequence
+					const size_t k = detail::ascii_prefix(s + i, n - i);
+					const void* esc = std::memchr(s + i, '\x1b', k);
+					const size_t m = esc == nullptr ? k : static_cast<size_t>(static_cast<const char*>(esc) - (s + i));
+					count += m;
+					i += m;
+					if (i == n)
+						break;
+				}
+				feed(static_cast<unsigned char>(s[i++]));
+			}
+		}
+		// the count of columns of the text so far
+		size_t size() const noexcept { return count + (pending != 0 ? seen : 0); }
+
+	private:
+		void feed(unsigned char b) noexcept
+		{
+			if (escape != 0)
+			{
+				// ESC, then '[', then parameters until a byte in [0x40, 0x7E]
+				escape = escape == 1 && b != '[' ? 0 : b >= 0x40 && b <= 0x7E && escape == 2 ? 0 : 2;
+				return;
+			}
+			if (pending != 0)
+			{
+				if ((b & 0xC0) == 0x80)
+				{
+					buffer[seen++] = static_cast<char>(b);
+					if (--pending == 0)
+					{
+						char32_t c = 0;
+						count += detail::decode_utf8(buffer, seen, c) == seen ? detail::column_width(c) : seen;
+					}
+					return;
+				}
+				// truncated sequence
+				count += seen;
+				pending = 0;
+			}
+			if (b == 0x1B)
+				escape = 1;
+			else if (b < 0x80)
+				++count;
+			else if (b >= 0xC2 && b <= 0xF4)
+			{
+				buffer[0] = static_cast<char>(b);
+				seen = 1;
+				pending = b < 0xE0 ? 1 : b < 0xF0 ? 2 : 3;
+			}
+			else
+				++count;
+		}
+
+		size_t count{0};
+		char buffer[4]{};
+		size_t seen{0};    // bytes of the current sequence seen
+		size_t pending{0}; // bytes of the current sequence still to come
+		int escape{0};     // 1 after ESC, 2 inside a control sequence
+	};
+
+	// display_width: the count of columns the UTF-8 text `s` takes on a terminal
+	inline size_t display_width(std::string_view s) noexcept
+	{
+		width_sink w;
+		w.append(s.data(), s.size());
+		return w.size();
+	}
+
+	namespace detail
+	{
+		// format UTF-16 or UTF-32 strings, transcoded to UTF-8
+		template<typename C>
+		struct utf_trait
+		{
+			template<typename Sink>
+			static void format_append(Sink& res, std::basic_string_view<C> s) { transcode_to(res, s.data(), s.size()); }
+			// at most 3 UTF-8 characters for a UTF-16 code unit, 4 for a UTF-32 one
+			static size_t formatted_size(std::basic_string_view<C> s) { return s.size() * (sizeof(C) == 2 ? 3 : 4); }
+		};
+	} // namespace detail
+
+	template<> // format a UTF-16 std::u16string as UTF-8
+	struct format_trait<std::u16string> : detail::utf_trait<char16_t>
+	{};
+	template<> // format a UTF-16 std::u16string_view as UTF-8
+	struct format_trait<std::u16string_view> : detail::utf_trait<char16_t>
+	{};
+	template<> // format a UTF-16 NUL-terminated string as UTF-8
+	struct format_trait<const char16_t*> : detail::utf_trait<char16_t>
+	{};
+	template<> // format a non-const UTF-16 NUL-terminated string as UTF-8
+	struct format_trait<char16_t*> : detail::utf_trait<char16_t>
+	{};
+	template<> // format a UTF-32 std::u32string as UTF-8
+	struct format_trait<std::u32string> : detail::utf_trait<char32_t>
+	{};
+	template<> // format a UTF-32 std::u32string_view as UTF-8
+	struct format_trait<std::u32string_view> : detail::utf_trait<char32_t>
+	{};
+	template<> // format a UTF-32 NUL-terminated string as UTF-8
+	struct format_trait<const char32_t*> : detail::utf_trait<char32_t>
+	{};
+	template<> // format a non-const UTF-32 NUL-terminated string as UTF-8
+	struct format_trait<char32_t*> : detail::utf_trait<char32_t>
+	{};
+
+	template<> // format a UTF-16 code unit as UTF-8, a surrogate becomes U+FFFD
+	struct format_trait<char16_t>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, char16_t c)
+		{
+			char buffer[4];
+			res.append(buffer, detail::encode_utf8(c, buffer));
+		}
+		static constexpr size_t formatted_size(char16_t) { return 3; }
+	};
+
+	template<> // format a code point as UTF-8
+	struct format_trait<char32_t>
+	{
+		template<typename Sink>
+		static void format_append(Sink& res, char32_t c)
+		{
+			char buffer[4];
+			res.append(buffer, detail::encode_utf8(c, buffer));
+		}
+		static constexpr size_t formatted_size(char32_t) { return 4; }
+	};
+} // namespace lava::format::legacy
@@ -0,0 +1,102 @@
+#pragma once
+#include "basic.h"
+#include "buffer.h"
+#include <string>
+#include <type_traits>
+
+// the type-erased core is kept out of line, for all the call sites to share it
+#if defined(_MSC_VER)
+#	define LAVA_FORMAT_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__)
+#	define LAVA_FORMAT_NOINLINE [[gnu::noinline]]
+#else
+#	define LAVA_FORMAT_NOINLINE
+#endif
+
+namespace lava::format::legacy
+{
+	// an argument with its type erased: a pointer to it, and the functions formatting it
+	// the functions are instantiated once for each type, shared by all the call sites
+	struct format_arg
+	{
+		const void* value;
+		void (*append)(std::string& res, const void* x);
+		size_t (*size)(const void* x);
+	};
+
+	// the arguments of a call, type-erased, see `make_format_args`
+	struct format_args
+	{
+		const format_arg* data;
+		size_t count;
+	};
+
+	namespace detail
+	{
+		template<typename T>
+		inline void erased_append(std::string& res, const void* x)
+		{
+			format_one(res, *static_cast<const T*>(x));
+		}
+		template<typename T>
+		inline size_t erased_size(const void* x)
+		{
+			return formatted_size_of<T>(*static_cast<const T*>(x));
+		}
+
+		// character arrays are passed as `const char*`, not as one type for each length
+		inline void erased_append_text(std::string& res, const void* x)
+		{
+			format_one(res, static_cast<const char*>(x));
+		}
+		inline size_t erased_size_text(const void* x)
+		{
+			return formatted_size_of<const char*>(static_cast<const char*>(x));
+		}
+	} // namespace detail
+
+	// erase the type of `x`, which must outlive the format_arg
+	template<typename U>
+	inline format_arg make_format_arg(const U& x) noexcept
+	{
+		if constexpr (std::is_array_v<U> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<U>>, char>)
+			return {x, detail::erased_append_text, detail::erased_size_text};
+		else
+			return {&x, detail::erased_append<U>, detail::erased_size<U>};
+	}
+
+	// vformat_s: the core of the type-erased formatting, the same code for all the arguments
+	// the space needed is reserved once, before any parameter is formatted
+	LAVA_FORMAT_NOINLINE inline void vformat_s(std::string& res, format_args args)
+	{
+		size_t n = 0;
+		for (size_t i = 0; i != args.count; ++i)
+			n += args.data[i].size(args.data[i].value);
+		detail::reserve_append(res, n);
+		for (size_t i = 0; i != args.count; ++i)
+			args.data[i].append(res, args.data[i].value);
+	}
+
+	// vformat_s: format all the parameters to string `res`, through `vformat_s(res, format_args)`
+	// each call site only packs the arguments: prefer it to `format_s` where code size matters more than speed
+	template<typename... Us>
+	inline void vformat_s(std::string& res, const Us&... xs)
+	{
+		const format_arg args[sizeof...(Us) + 1]{make_format_arg(xs)...};
+		vformat_s(res, format_args{args, sizeof...(Us)});
+	}
+
+	// vformat_scoped: `format_scoped` through `vformat_s`
+	LAVA_FORMAT_NOINLINE inline scoped_buffer vformat_scoped(format_args args)
+	{
+		scoped_buffer res{};
+		vformat_s(res.str(), args);
+		return res;
+	}
+	template<typename... Us>
+	inline scoped_buffer vformat_scoped(const Us&... xs)
+	{
+		const format_arg args[sizeof...(Us) + 1]{make_format_arg(xs)...};
+		return vformat_scoped(format_args{args, sizeof...(Us)});
+	}
+} // namespace lava::format::legacy
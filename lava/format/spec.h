@@ -0,0 +1,211 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+namespace lava::format
+{
+	// all format strings derive from this tag, see `fmtString`
+	struct format_string_base
+	{};
+
+	// fmtString: make a format string, whose text is known to the compiler
+	// a format string is a type with `static constexpr std::string_view value()`
+#define fmtString(s)                                                          \
+	[] {                                                                      \
+		struct format_string_t : lava::format::format_string_base             \
+		{                                                                     \
+			static constexpr std::string_view value() noexcept { return s; } \
+		};                                                                    \
+		return format_string_t{};                                             \
+	}()
+
+	template<typename S>
+	constexpr bool is_format_string = std::is_base_of_v<format_string_base, S>;
+
+	// the format specification of a replacement field: {[index][:[[fill]align][0][width][.precision][type]]}
+	struct spec
+	{
+		char fill{' '};
+		char align{'\0'}; // '<', '>', '^', '=' (after the sign), or '\0' for the default
+		unsigned width{0};
+		int precision{-1}; // -1 if not specified
+		char type{'\0'};   // one of "sdxXoObBcfFeEgG", or '\0' for the default
+	};
+
+	// a piece of the format string: either a run of literal text, or a replacement field
+	struct segment
+	{
+		bool is_field{false};
+		size_t begin{0}; // literal text: the position in the format string
+		size_t size{0};  // literal text: the length
+		size_t index{0}; // replacement field: the index of the argument
+		spec format{};
+	};
+
+	enum class parse_error
+	{
+		none,
+		unmatched_open,  // a '{' without the closing '}'
+		unmatched_close, // a '}' which is neither escaped nor closing a field
+		mixed_indexing,  // both automatic `{}` and manual `{0}` indices are used
+		invalid_spec,    // a malformed format specification
+	};
+
+	namespace detail
+	{
+		constexpr bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+		constexpr bool is_align(char c) noexcept { return c == '<' || c == '>' || c == '^'; }
+		constexpr bool is_type(char c) noexcept
+		{
+			for (char t : std::string_view{"sdxXoObBcfFeEgG"})
+				if (c == t)
+					return true;
+			return false;
+		}
+
+		// parse the format string `s`
+		// `out` receives the segments (if not null), `count` the count of segments,
+		// and `args` the count of arguments referred to
+		constexpr parse_error parse(std::string_view s, segment* out, size_t& count, size_t& args) noexcept
+		{
+			count = 0;
+			args = 0;
+			int manual = -1; // unknown yet, 0 for automatic, 1 for manual indices
+			size_t next = 0; // the next automatic index
+			auto emit = [&](const segment& seg) {
+				if (out != nullptr)
+					out[count] = seg;
+				++count;
+			};
+			auto emit_text = [&](size_t b, size_t e) {
+				if (e > b)
+					emit(segment{false, b, e - b});
+			};
+
+			const size_t n = s.size();
+			size_t text = 0;
+			for (size_t i = 0; i < n;)
+			{
+				if (s[i] == '}')
+				{
+					if (i + 1 == n || s[i + 1] != '}')
+						return parse_error::unmatched_close;
+					emit_text(text, i + 1);
+					text = i += 2;
+					continue;
+				}
+				if (s[i] != '{')
+				{
+					++i;
+					continue;
+				}
+				if (i + 1 < n && s[i + 1] == '{')
+				{
+					emit_text(text, i + 1);
+					text = i += 2;
+					continue;
+				}
+				emit_text(text, i++);
+
+				// argument index
+				segment field{true};
+				if (i < n && is_digit(s[i]))
+				{
+					if (manual == 0)
+						return parse_error::mixed_indexing;
+					manual = 1;
+					for (; i < n && is_digit(s[i]); ++i)
+						field.index = field.index * 10 + static_cast<size_t>(s[i] - '0');
+				}
+				else
+				{
+					if (manual == 1)
+						return parse_error::mixed_indexing;
+					manual = 0;
+					field.index = next++;
+				}
+
+				// format specification
+				if (i < n && s[i] == ':')
+				{
+					++i;
+					if (i + 1 < n && is_align(s[i + 1]) && s[i] != '{' && s[i] != '}')
+					{
+						field.format.fill = s[i];
+						field.format.align = s[i + 1];
+						i += 2;
+					}
+					else if (i < n && is_align(s[i]))
+						field.format.align = s[i++];
+					if (i < n && s[i] == '0' && field.format.align == '\0')
+					{
+						field.format.fill = '0';
+						field.format.align = '=';
+						++i;
+					}
+					for (; i < n && is_digit(s[i]); ++i)
+						field.format.width = field.format.width * 10 + static_cast<unsigned>(s[i] - '0');
+					if (i < n && s[i] == '.')
+					{
+						if (++i == n || !is_digit(s[i]))
+							return parse_error::invalid_spec;
+						field.format.precision = 0;
+						for (; i < n && is_digit(s[i]); ++i)
+							field.format.precision = field.format.precision * 10 + (s[i] - '0');
+					}
+					if (i < n && is_type(s[i]))
+						field.format.type = s[i++];
+				}
+				if (i == n)
+					return parse_error::unmatched_open;
+				if (s[i] != '}')
+					return parse_error::invalid_spec;
+				++i;
+				text = i;
+				emit(field);
+				args = field.index + 1 > args ? field.index + 1 : args;
+			}
+			emit_text(text, n);
+			return parse_error::none;
+		}
+	} // namespace detail
+
+	// the parsed format string S: segments of literal text and replacement fields
+	template<typename S>
+	struct format_plan
+	{
+		static constexpr std::string_view text = S::value();
+
+	private:
+		struct counts
+		{
+			parse_error error;
+			size_t segments;
+			size_t args;
+		};
+		static constexpr counts count = [] {
+			counts c{};
+			c.error = detail::parse(text, nullptr, c.segments, c.args);
+			return c;
+		}();
+
+	public:
+		static constexpr parse_error error = count.error;
+		static constexpr size_t args = count.args;
+		static constexpr auto segments = [] {
+			std::array<segment, count.segments> result{};
+			size_t n = 0, m = 0;
+			detail::parse(text, result.data(), n, m);
+			return result;
+		}();
+		// the length of all the literal text, plus the widths of all the fields
+		static constexpr size_t size_hint = [] {
+			size_t n = 0;
+			for (const auto& seg : segments)
+				n += seg.is_field ? seg.format.width : seg.size;
+			return n;
+		}();
+	};
+} // namespace lava::format
@@ -0,0 +1,462 @@
+#pragma once
+#include <lava/format/legacy.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace lava::log
+{
+	// trait deferred_by_value<T>: whether a T can be copied to the log as raw bytes, and formatted later
+	// T should be trivially copyable, and refer to nothing (a reference or a pointer may dangle)
+	// specialize it for such types of your own
+	template<typename T>
+	struct deferred_by_value : std::bool_constant<std::is_arithmetic_v<T> || std::is_enum_v<T>>
+	{};
+	template<typename T, T base, bool capital>
+	struct deferred_by_value<format::legacy::num_base<T, base, capital>> : std::true_type
+	{};
+	template<typename T, format::legacy::float_style style, bool capital>
+	struct deferred_by_value<format::legacy::float_base<T, style, capital>> : std::true_type
+	{};
+	template<typename T>
+	struct deferred_by_value<format::legacy::literal<T>> : std::bool_constant<format::legacy::is_char<T>>
+	{};
+	template<>
+	struct deferred_by_value<format::legacy::unicode> : std::true_type
+	{};
+	template<>
+	struct deferred_by_value<format::legacy::endl_t> : std::true_type
+	{};
+	template<>
+	struct deferred_by_value<format::legacy::ansi> : std::true_type
+	{};
+
+	// what to do when the log is full
+	enum class overflow_policy : unsigned char
+	{
+		block, // wait for the background thread to make room
+		drop,  // discard the message, see `logger::dropped`
+		grow   // keep the message in an unbounded queue, taken by the background thread later
+	};
+
+	namespace detail
+	{
+		// arguments are stored in the log as raw bytes (values), or as text:
+		// texts are copied, other types are formatted on the calling thread
+		template<typename T>
+		constexpr bool by_value = deferred_by_value<T>::value;
+		template<typename T>
+		constexpr bool by_text = !by_value<T> && std::is_convertible_v<const T&, std::string_view>;
+
+		// the argument, ready to be copied to the log
+		template<typename T>
+		using prepared_t = std::conditional_t<
+			by_value<T>, const T&,
+			std::conditional_t<by_text<T>, std::string_view, format::legacy::scoped_buffer>>;
+		// the argument, as stored in the log
+		template<typename T>
+		using stored_t = std::conditional_t<by_value<T>, T, std::string_view>;
+
+		template<typename T>
+		inline prepared_t<T> prepare(const T& x)
+		{
+			if constexpr (by_value<T>)
+			{
+				static_assert(std::is_trivially_copyable_v<T>, "Types deferred by value should be trivially copyable.");
+				return x;
+			}
+			else if constexpr (by_text<T>)
+				return x;
+			else
+				return format::legacy::format_scoped(x);
+		}
+
+		template<typename T>
+		inline size_t stored_size(const T& x)
+		{
+			if constexpr (std::is_same_v<T, format::legacy::scoped_buffer>)
+				return sizeof(size_t) + x.size();
+			else if constexpr (std::is_same_v<T, std::string_view>)
+				return sizeof(size_t) + x.size();
+			else
+				return sizeof(T);
+		}
+
+		template<typename T>
+		inline char* store(char* p, const T& x)
+		{
+			if constexpr (std::is_same_v<T, format::legacy::scoped_buffer>)
+				return store(p, x.view());
+			else if constexpr (std::is_same_v<T, std::string_view>)
+			{
+				const size_t n = x.size();
+				std::memcpy(p, &n, sizeof(n));
+				std::memcpy(p + sizeof(n), x.data(), n);
+				return p + sizeof(n) + n;
+			}
+			else
+			{
+				std::memcpy(p, &x, sizeof(T));
+				return p + sizeof(T);
+			}
+		}
+
+		// read one argument stored at `p`, format it to `res`, and skip it
+		template<typename T>
+		inline void load(std::string& res, const char*& p)
+		{
+			if constexpr (std::is_same_v<T, std::string_view>)
+			{
+				size_t n;
+				std::memcpy(&n, p, sizeof(n));
+				res.append(p + sizeof(n), n);
+				p += sizeof(n) + n;
+			}
+			else
+			{
+				alignas(T) unsigned char raw[sizeof(T)];
+				std::memcpy(raw, p, sizeof(T));
+				format::legacy::format_to(res, *std::launder(reinterpret_cast<const T*>(raw)));
+				p += sizeof(T);
+			}
+		}
+
+		// format the arguments stored at `p`, on the background thread
+		using render_t = void (*)(std::string& res, const char* p);
+		template<typename... Ts>
+		inline void render(std::string& res, const char* p)
+		{
+			(load<Ts>(res, p), ...);
+			static_cast<void>(p);
+		}
+
+		// a record: a header word (its size), the renderer, and the arguments
+		// records are aligned to 8 bytes; a header with the lowest bit set marks padding to skip
+		// in the ring, the header of each record is kept aside, in an atomic word for each 8 bytes
+		constexpr size_t record_header = 2 * sizeof(uint64_t);
+		constexpr uint64_t padding_bit = 1;
+		inline size_t record_size(size_t n) { return (record_header + n + 7) & ~size_t{7}; }
+
+		// a lock-free ring of records, for multiple producers and a single consumer
+		// producers reserve space with a CAS on `head`, then publish the record by its header (0 while being written)
+		// the consumer resets the headers of the records it takes before giving the space back through `tail`
+		class ring
+		{
+		public:
+			explicit ring(size_t capacity)
+				: mask{round_capacity(capacity) - 1}
+				, data{new char[mask + 1]}
+				, headers{new std::atomic<uint64_t>[(mask + 1) / sizeof(uint64_t)]}
+			{
+				for (size_t i = 0; i != (mask + 1) / sizeof(uint64_t); ++i)
+					headers[i].store(0, std::memory_order_relaxed);
+			}
+
+			size_t capacity() const noexcept { return mask + 1; }
+
+			// reserve a record of `size` bytes, return nullptr if the ring is full
+			char* reserve(size_t size)
+			{
+				uint64_t h = head.load(std::memory_order_relaxed);
+				size_t pad;
+				do
+				{
+					// a record never wraps around: the end of the ring is skipped instead
+					const size_t offset = static_cast<size_t>(h) & mask;
+					pad = capacity() - offset < size ? capacity() - offset : 0;
+					if (h + pad + size - tail.load(std::memory_order_acquire) > capacity())
+						return nullptr;
+				} while (!head.compare_exchange_weak(h, h + pad + size, std::memory_order_relaxed));
+				if (pad != 0)
+					header(h).store(pad | padding_bit, std::memory_order_release);
+				return data.get() + ((h + pad) & mask);
+			}
+			// publish a record reserved by `reserve`
+			void commit(char* record, size_t size) noexcept
+			{
+				header(static_cast<uint64_t>(record - data.get())).store(size, std::memory_order_release);
+			}
+
+			// pass the published records to `f` in order, return whether any was taken
+			// stop at the first record still being written
+			template<typename F>
+			bool consume(F&& f)
+			{
+				uint64_t t = tail.load(std::memory_order_relaxed);
+				bool taken = false;
+				while (true)
+				{
+					std::atomic<uint64_t>& word = header(t);
+					const uint64_t h = word.load(std::memory_order_acquire);
+					if (h == 0)
+						break;
+					if ((h & padding_bit) == 0)
+						f(static_cast<const char*>(data.get() + (t & mask)));
+					word.store(0, std::memory_order_relaxed);
+					t += h & ~padding_bit;
+					tail.store(t, std::memory_order_release);
+					taken = true;
+				}
+				return taken;
+			}
+			// whether all the reserved records are taken
+			bool empty() const noexcept
+			{
+				return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+			}
+
+		private:
+			static size_t round_capacity(size_t n)
+			{
+				size_t c = 4096;
+				while (c < n)
+					c *= 2;
+				return c;
+			}
+			std::atomic<uint64_t>& header(uint64_t pos) noexcept
+			{
+				return headers[(static_cast<size_t>(pos) & mask) / sizeof(uint64_t)];
+			}
+
+			const size_t mask;
+			std::unique_ptr<char[]> data;
+			std::unique_ptr<std::atomic<uint64_t>[]> headers;
+			alignas(64) std::atomic<uint64_t> head{0};
+			alignas(64) std::atomic<uint64_t> tail{0};
+		};
+
+		// format a record taken from the ring or the overflow queue
+		inline void render_record(std::string& res, const char* record)
+		{
+			render_t f;
+			std::memcpy(&f, record + sizeof(uint64_t), sizeof(f));
+			f(res, record + record_header);
+		}
+	} // namespace detail
+
+	// an asynchronous logger
+	// `log` copies its arguments to a lock-free ring, and a background thread formats and writes them
+	// numbers, characters, colours and other values (see `deferred_by_value`) are formatted later,
+	// texts are copied as-is, and other types are formatted on the calling thread
+	// messages from one thread are written in order, and the writer is only called from the background thread
+	class logger
+	{
+	public:
+		// `writer` is called as `bool(const char* s, size_t n)`, as in format::legacy::buffered_sink
+		using writer_t = std::function<bool(const char*, size_t)>;
+
+		// `fd` is the file descriptor the writer writes to, for the automatic colour policy (see format::legacy::colour_enabled)
+		// -1 when there is none: no colour is written under the automatic policy
+		explicit logger(writer_t writer, size_t capacity = 1 << 20, overflow_policy policy = overflow_policy::block, int fd = -1)
+			: writer{std::move(writer)}
+			, policy{policy}
+			, destination{fd}
+			, records{capacity}
+			, consumer{[this] { run(); }}
+		{}
+		explicit logger(std::ostream& os, size_t capacity = 1 << 20, overflow_policy policy = overflow_policy::block)
+			: logger{format::legacy::streambuf_writer{os.rdbuf()}, capacity, policy, format::legacy::detail::stream_fd(os)}
+		{}
+		explicit logger(std::FILE* file, size_t capacity = 1 << 20, overflow_policy policy = overflow_policy::block)
+			: logger{format::legacy::file_writer{file}, capacity, policy, format::legacy::detail::file_fd(file)}
+		{}
+		// write all the messages, then stop the background thread
+		~logger()
+		{
+			stopping.store(true, std::memory_order_release);
+			wake();
+			consumer.join();
+		}
+		logger(const logger&) = delete;
+		logger& operator=(const logger&) = delete;
+
+		// log a message made of all the parameters, formatted as by format::legacy::format
+		// return false if the message is dropped (see overflow_policy::drop)
+		template<typename... Us>
+		bool log(const Us&... xs)
+		{
+			// values formatted now take the colour policy of the destination, as those formatted later
+			const format::legacy::detail::destination_scope scope{destination};
+			const std::tuple<detail::prepared_t<Us>...> args{detail::prepare(xs)...};
+			const size_t size = detail::record_size(
+				std::apply([](const auto&... ps) { return (size_t{0} + ... + detail::stored_size(ps)); }, args));
+			const auto write = [&args](char* record) {
+				const detail::render_t f = &detail::render<detail::stored_t<Us>...>;
+				std::memcpy(record + sizeof(uint64_t), &f, sizeof(f));
+				std::apply(
+					[p = record + detail::record_header](const auto&... ps) mutable { ((p = detail::store(p, ps)), ...); },
+					args);
+			};
+			return push(size, write);
+		}
+
+		// wait until all the messages logged so far are written
+		void flush()
+		{
+			const uint64_t request = flush_requested.fetch_add(1, std::memory_order_acq_rel) + 1;
+			wake();
+			std::unique_lock<std::mutex> lock{mutex};
+			flushed.wait(lock, [&] { return flush_done >= request; });
+		}
+
+		// the count of messages dropped, under overflow_policy::drop
+		size_t dropped() const noexcept { return dropped_count.load(std::memory_order_relaxed); }
+		// whether the writer failed at least once
+		bool failed() const noexcept { return write_failed.load(std::memory_order_relaxed); }
+		// the count of bytes the writer failed to write
+		size_t lost() const noexcept { return lost_bytes.load(std::memory_order_relaxed); }
+
+	private:
+		template<typename Write>
+		bool push(size_t size, const Write& write)
+		{
+			// once messages overflow, the following ones queue behind them, to keep them in order
+			// a record of at most half the ring always fits, at its end or at its start
+			if (size <= records.capacity() / 2 && !spilling.load(std::memory_order_acquire))
+				while (true)
+				{
+					if (char* record = records.reserve(size))
+					{
+						write(record);
+						records.commit(record, size);
+						// pairs with the fence of the background thread going to sleep:
+						// either it sees the record, or this thread sees it sleeping
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+						if (sleeping.load(std::memory_order_relaxed))
+							wake();
+						return true;
+					}
+					if (policy == overflow_policy::drop)
+					{
+						dropped_count.fetch_add(1, std::memory_order_relaxed);
+						return false;
+					}
+					if (policy == overflow_policy::grow)
+						break;
+					wake();
+					std::this_thread::yield();
+				}
+			// larger messages go to the overflow queue, whatever the policy
+			std::string record(size, '\0');
+			write(record.data());
+			const uint64_t header = size;
+			std::memcpy(record.data(), &header, sizeof(header));
+			{
+				const std::lock_guard<std::mutex> lock{mutex};
+				overflow.append(record);
+				spilling.store(true, std::memory_order_release);
+			}
+			wake();
+			return true;
+		}
+
+		// under the lock, so that the wake-up is not lost between the check and the wait of the background thread
+		void wake()
+		{
+			const std::lock_guard<std::mutex> lock{mutex};
+			ready.notify_one();
+		}
+
+		// the background thread
+		void run()
+		{
+			const format::legacy::detail::destination_scope scope{destination};
+			std::string text{};
+			std::string spilled{};
+			uint64_t served = 0;
+			const auto take = [&text](const char* record) { detail::render_record(text, record); };
+			while (true)
+			{
+				const uint64_t request = flush_requested.load(std::memory_order_acquire);
+				const bool stop = stopping.load(std::memory_order_acquire);
+				bool progress = records.consume(take);
+				bool drained = false;
+				{
+					// the overflow queue is taken only after the records before it
+					const std::lock_guard<std::mutex> lock{mutex};
+					if (records.empty())
+					{
+						drained = true;
+						spilled.swap(overflow);
+						spilling.store(false, std::memory_order_release);
+					}
+				}
+				for (size_t i = 0; i != spilled.size();)
+				{
+					uint64_t size;
+					std::memcpy(&size, spilled.data() + i, sizeof(size));
+					take(spilled.data() + i);
+					i += static_cast<size_t>(size);
+				}
+				progress |= !spilled.empty();
+				spilled.clear();
+				if (!text.empty())
+				{
+					if (!writer(text.data(), text.size()))
+					{
+						lost_bytes.fetch_add(text.size(), std::memory_order_relaxed);
+						write_failed.store(true, std::memory_order_relaxed);
+					}
+					text.clear();
+				}
+				// all the messages logged before the flush request are written
+				if (drained && request != served)
+				{
+					const std::lock_guard<std::mutex> lock{mutex};
+					flush_done = served = request;
+					flushed.notify_all();
+				}
+				if (progress)
+					continue;
+				if (!drained)
+				{
+					// a record is still being written
+					std::this_thread::yield();
+					continue;
+				}
+				if (stop)
+					return;
+				std::unique_lock<std::mutex> lock{mutex};
+				sleeping.store(true, std::memory_order_relaxed);
+				// pairs with the fence of the producers: see `push`
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				ready.wait(lock, [&] {
+					return !records.empty() || !overflow.empty() || stopping.load(std::memory_order_acquire)
+						|| flush_requested.load(std::memory_order_acquire) != request;
+				});
+				sleeping.store(false, std::memory_order_relaxed);
+			}
+		}
+
+		writer_t writer;
+		const overflow_policy policy;
+		const int destination;
+		detail::ring records;
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::condition_variable flushed;
+		std::string overflow{};
+		std::atomic<bool> spilling{false};
+		std::atomic<bool> sleeping{false};
+		std::atomic<bool> stopping{false};
+		std::atomic<uint64_t> flush_requested{0};
+		uint64_t flush_done{0};
+		std::atomic<size_t> dropped_count{0};
+		std::atomic<bool> write_failed{false};
+		std::atomic<size_t> lost_bytes{0};
+		std::thread consumer;
+	};
+} // namespace lava::log
@@ -23,7 +23,7 @@ namespace lava
 		{}
 		resource_many& operator=(resource_many&& obj) assert_except
 		{
-			expects(&obj != this, msg_should_not_move_to_this);
+			expects(&obj != this, lava::config::tr(lava::config::message::should_not_move_to_this));
 			resource = std::move(obj.resource);
 			return *this;
 		}
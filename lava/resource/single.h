@@ -23,7 +23,7 @@ namespace lava
 		}
 		resource_single& operator=(resource_single&& obj) assert_except
 		{
-			expects(&obj != this, msg_should_not_move_to_this);
+			expects(&obj != this, lava::config::tr(lava::config::message::should_not_move_to_this));
 			rawPtr = obj.rawPtr;
 			obj.rawPtr = nullptr;
 			return *this;
@@ -0,0 +1,466 @@
+#pragma once
+#include <lava/ascii.h>
+#include <lava/enums.h>
+#include <lava/format/legacy/escape.h>
+#include <lava/format/legacy/integers.h>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+#	define LAVA_SCAN_HAS_SWAR
+#endif
+
+// lava::scan: parsing text produced by lava.format
+// each wrapper of lava::scan inverts the lava.format wrapper of the same name
+namespace lava::scan
+{
+	enum class scan_errc
+	{
+		ok,
+		invalid,  // no value is found, e.g. no digit
+		overflow, // the value does not fit in its type
+		mismatch  // the expected text is not found
+	};
+
+	// the result of a scan: where it stopped, and why
+	// as with std::from_chars, `ptr` is past the digits on overflow, and values are left untouched on error
+	struct scan_result
+	{
+		const char* ptr;
+		scan_errc ec;
+		explicit operator bool() const noexcept { return ec == scan_errc::ok; }
+	};
+
+	// trait scan_trait<T>
+	// scan_trait<T>::scan(first, last, x) parses the text at [first, last) to `x`, returns a scan_result
+	template<typename T>
+	struct scan_trait;
+
+	template<typename T, T base = 10>
+	struct num_base // scan a integer in the given base
+	{
+		static_assert(1 < base && base <= 36, "Base allowed in [2, 36].");
+		T& value;
+	};
+	// helper function `number`
+	template<long long base = 10, typename T>
+	constexpr num_base<T, T(base)> number(T& x)
+	{
+		return {x};
+	}
+
+#define DEFINE_NUM_BASE(name, base)          \
+	template<typename T>                     \
+	constexpr num_base<T, base> name(T& x)   \
+	{                                        \
+		return {x};                          \
+	}
+	// define helper functions for the 4 bases: 2, 8, 10, 16
+	DEFINE_NUM_BASE(hexadecimal, 16)
+	DEFINE_NUM_BASE(decimal, 10)
+	DEFINE_NUM_BASE(octal, 8)
+	DEFINE_NUM_BASE(binary, 2)
+#undef DEFINE_NUM_BASE
+
+	template<typename T>
+	struct literal // scan a quoted and escaped string or character, see lava::format::legacy::literal
+	{
+		T& value;
+	};
+	template<typename T>
+	constexpr literal<T> quoted(T& x)
+	{
+		return {x};
+	}
+
+	template<typename E>
+	struct enumeration // scan the name of an enumerator, see lava::enums::name_of
+	{
+		static_assert(std::is_enum_v<E>, "Only enum types allowed.");
+		E& value;
+	};
+	template<typename E>
+	constexpr enumeration<E> enum_name(E& x)
+	{
+		return {x};
+	}
+
+	namespace detail
+	{
+		using lava::format::legacy::detail::integer_traits;
+
+		// the value of each digit in bases up to 36, 0xFF for the other characters
+		inline constexpr auto digit_values = [] {
+			std::array<unsigned char, 256> t{};
+			for (auto& v : t)
+				v = 0xFF;
+			for (int i = 0; i < 10; ++i)
+				t['0' + i] = static_cast<unsigned char>(i);
+			for (int i = 0; i < 26; ++i)
+				t['a' + i] = t['A' + i] = static_cast<unsigned char>(10 + i);
+			return t;
+		}();
+		constexpr unsigned digit_of(char c) noexcept { return digit_values[static_cast<unsigned char>(c)]; }
+
+#ifdef LAVA_SCAN_HAS_SWAR
+		inline uint64_t load8(const char* p) noexcept
+		{
+			uint64_t v;
+			std::memcpy(&v, p, sizeof(v));
+			return v;
+		}
+		// whether the 8 characters in `v` are all decimal digits
+		constexpr bool all_digits(uint64_t v) noexcept
+		{
+			// a digit is 0x30 to 0x39: its high nibble is 3, and adding 6 does not carry into it
+			return ((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+				   == 0x3333333333333333;
+		}
+		// the value of 8 decimal digits, the first one in the lowest byte
+		constexpr uint64_t parse8(uint64_t v) noexcept
+		{
+			// combine adjacent digits to 2-digit, then 4-digit, then 8-digit values
+			v -= 0x3030303030303030;
+			v = v * 10 + (v >> 8);
+			return (((v & 0x000000FF000000FF) * (100 + (1000000ull << 32)))
+					+ (((v >> 16) & 0x000000FF000000FF) * (1 + (10000ull << 32))))
+				   >> 32;
+		}
+
+		// whether the 8 characters in `v` are all hexadecimal digits, of either case
+		constexpr bool all_hex_digits(uint64_t v) noexcept
+		{
+			// for ASCII bytes, adding 0x80 - m sets the high bit exactly when the byte is at least m, with no carry
+			constexpr uint64_t ones = 0x0101010101010101;
+			constexpr uint64_t high = 0x8080808080808080;
+			const auto at_least = [](uint64_t x, uint64_t m) { return (x + ones * (0x80 - m)) & high; };
+			const uint64_t lower = v | ones * 0x20;
+			const uint64_t digits = at_least(v, '0') & ~at_least(v, '9' + 1);
+			const uint64_t letters = at_least(lower, 'a') & ~at_least(lower, 'f' + 1);
+			return (v & high) == 0 && (digits | letters) == high;
+		}
+		// the value of 8 hexadecimal digits, the first one in the lowest byte
+		constexpr uint64_t parse8_hex(uint64_t v) noexcept
+		{
+			// the low nibble is the value of a digit, and 9 less than the value of a letter (letters have bit 6 set)
+			v = (v & 0x0F0F0F0F0F0F0F0F) + ((v >> 6) & 0x0101010101010101) * 9;
+			// combine adjacent digits to 2-digit, then 4-digit, then 8-digit values
+			v = ((v << 4) | (v >> 8)) & 0x00FF00FF00FF00FF;
+			v = ((v << 8) | (v >> 16)) & 0x0000FFFF0000FFFF;
+			return ((v << 16) | (v >> 32)) & 0xFFFFFFFF;
+		}
+#endif
+
+		// parse decimal digits to a 64-bit magnitude
+		// up to 19 digits cannot overflow, digits beyond are checked one at a time
+		inline scan_errc parse_decimal(const char*& p, const char* last, uint64_t& out) noexcept
+		{
+			const char* const first = p;
+			uint64_t x = 0;
+#ifdef LAVA_SCAN_HAS_SWAR
+			// 16 digits, then 8 digits at a time
+			if (last - p >= 16)
+			{
+				const uint64_t lo = load8(p);
+				if (all_digits(lo))
+				{
+					const uint64_t hi = load8(p + 8);
+					if (all_digits(hi))
+					{
+						x = parse8(lo) * 100000000 + parse8(hi);
+						p += 16;
+					}
+					else
+					{
+						x = parse8(lo);
+						p += 8;
+					}
+				}
+			}
+			else if (last - p >= 8 && all_digits(load8(p)))
+			{
+				x = parse8(load8(p));
+				p += 8;
+			}
+#endif
+			for (; p != last && ascii::isdigit(*p) && p - first < 19; ++p)
+				x = x * 10 + static_cast<unsigned>(*p - '0');
+			if (p == first)
+				return scan_errc::invalid;
+			bool overflow = false;
+			for (; p != last && ascii::isdigit(*p); ++p)
+			{
+				const auto d = static_cast<unsigned>(*p - '0');
+				if (x > (std::numeric_limits<uint64_t>::max() - d) / 10)
+					overflow = true;
+				else
+					x = x * 10 + d;
+			}
+			out = x;
+			return overflow ? scan_errc::overflow : scan_errc::ok;
+		}
+
+		// parse hexadecimal digits to a 64-bit magnitude
+		// up to 16 digits cannot overflow, digits beyond are checked one at a time
+		inline scan_errc parse_hexadecimal(const char*& p, const char* last, uint64_t& out) noexcept
+		{
+			const char* const first = p;
+			uint64_t x = 0;
+#ifdef LAVA_SCAN_HAS_SWAR
+			// 8 digits at a time, twice at most
+			if (last - p >= 8 && all_hex_digits(load8(p)))
+			{
+				x = parse8_hex(load8(p));
+				p += 8;
+				if (last - p >= 8 && all_hex_digits(load8(p)))
+				{
+					x = x << 32 | parse8_hex(load8(p));
+					p += 8;
+				}
+			}
+#endif
+			for (unsigned d; p != last && (d = digit_of(*p)) < 16 && p - first < 16; ++p)
+				x = x << 4 | d;
+			if (p == first)
+				return scan_errc::invalid;
+			bool overflow = false;
+			for (unsigned d; p != last && (d = digit_of(*p)) < 16; ++p)
+			{
+				if (x >> 60 != 0)
+					overflow = true;
+				else
+					x = x << 4 | d;
+			}
+			out = x;
+			return overflow ? scan_errc::overflow : scan_errc::ok;
+		}
+
+		// parse digits in any base to a magnitude of type V
+		template<typename V, unsigned base>
+		inline scan_errc parse_digits(const char*& p, const char* last, V& out) noexcept
+		{
+			const char* const first = p;
+			V x = 0;
+			bool overflow = false;
+			for (unsigned d; p != last && (d = digit_of(*p)) < base; ++p)
+			{
+				if (x > (static_cast<V>(~V{0}) - d) / base)
+					overflow = true;
+				else
+					x = static_cast<V>(x * base + d);
+			}
+			if (p == first)
+				return scan_errc::invalid;
+			out = x;
+			return overflow ? scan_errc::overflow : scan_errc::ok;
+		}
+
+		// the character after a backslash for each escaped character, see escape_table
+		inline constexpr auto unescape_table = [] {
+			std::array<char, 256> t{};
+			for (int c = 0; c < 256; ++c)
+				if (const char e = lava::format::legacy::detail::escape_table[c]; e != 0)
+					t[static_cast<unsigned char>(e)] = static_cast<char>(c);
+			return t;
+		}();
+
+		// parse a quoted literal, from `quote` to `quote`, the escapes decoded
+		// runs of plain characters are found in bulk, see find_escape
+		inline scan_errc parse_literal(const char*& p, const char* last, char quote, std::string& out)
+		{
+			using lava::format::legacy::detail::find_escape;
+			if (p == last || *p != quote)
+				return scan_errc::mismatch;
+			const char* q = p + 1;
+			std::string text{};
+			while (true)
+			{
+				const size_t n = find_escape(q, static_cast<size_t>(last - q));
+				text.append(q, n);
+				q += n;
+				if (q == last)
+					return scan_errc::invalid;
+				if (*q == quote)
+					break;
+				if (*q != '\\')
+				{
+					// a quote of the other kind, or a control character left as-is
+					text.push_back(*q++);
+					continue;
+				}
+				if (++q == last || (unescape_table[static_cast<unsigned char>(*q)] == 0 && *q != '0'))
+					return scan_errc::invalid;
+				text.push_back(unescape_table[static_cast<unsigned char>(*q++)]);
+			}
+			p = q + 1;
+			out = std::move(text);
+			return scan_errc::ok;
+		}
+	} // namespace detail
+
+	template<typename T, T base> // scan a integer in the given base
+	struct scan_trait<num_base<T, base>>
+	{
+		using V = typename detail::integer_traits<T>::unsigned_type;
+		static constexpr bool is_signed = detail::integer_traits<T>::is_signed;
+
+		static scan_result scan(const char* first, const char* last, num_base<T, base> x) noexcept
+		{
+			const char* p = first;
+			bool negative = false;
+			if constexpr (is_signed)
+				if (p != last && *p == '-')
+				{
+					negative = true;
+					++p;
+				}
+			V magnitude{};
+			scan_errc ec;
+			if constexpr ((base == 10 || base == 16) && sizeof(V) <= sizeof(uint64_t))
+			{
+				uint64_t wide = 0;
+				if constexpr (base == 10)
+					ec = detail::parse_decimal(p, last, wide);
+				else
+					ec = detail::parse_hexadecimal(p, last, wide);
+				if (ec == scan_errc::ok && wide > static_cast<V>(~V{0}))
+					ec = scan_errc::overflow;
+				magnitude = static_cast<V>(wide);
+			}
+			else
+				ec = detail::parse_digits<V, static_cast<unsigned>(base)>(p, last, magnitude);
+			if (ec == scan_errc::invalid)
+				return {first, ec};
+			if constexpr (is_signed)
+			{
+				// the magnitude of the minimum is one more than the maximum
+				const V limit = static_cast<V>(static_cast<V>(~V{0}) >> 1) + negative;
+				if (ec == scan_errc::ok && magnitude > limit)
+					ec = scan_errc::overflow;
+			}
+			if (ec == scan_errc::ok)
+				x.value = static_cast<T>(negative ? static_cast<V>(V{0} - magnitude) : magnitude);
+			return {p, ec};
+		}
+	};
+
+	template<> // scan a boolean: "true" or "false"
+	struct scan_trait<bool>
+	{
+		static scan_result scan(const char* first, const char* last, bool& x) noexcept
+		{
+			const std::string_view s{first, static_cast<size_t>(last - first)};
+			if (s.substr(0, 4) == "true")
+			{
+				x = true;
+				return {first + 4, scan_errc::ok};
+			}
+			if (s.substr(0, 5) == "false")
+			{
+				x = false;
+				return {first + 5, scan_errc::ok};
+			}
+			return {first, scan_errc::invalid};
+		}
+	};
+
+	template<> // scan a character
+	struct scan_trait<char>
+	{
+		static scan_result scan(const char* first, const char* last, char& x) noexcept
+		{
+			if (first == last)
+				return {first, scan_errc::invalid};
+			x = *first;
+			return {first + 1, scan_errc::ok};
+		}
+	};
+
+	template<> // scan a quoted and escaped string
+	struct scan_trait<literal<std::string>>
+	{
+		static scan_result scan(const char* first, const char* last, literal<std::string> x)
+		{
+			const char* p = first;
+			const scan_errc ec = detail::parse_literal(p, last, '"', x.value);
+			return {ec == scan_errc::ok ? p : first, ec};
+		}
+	};
+
+	template<> // scan a quoted and escaped character
+	struct scan_trait<literal<char>>
+	{
+		static scan_result scan(const char* first, const char* last, literal<char> x)
+		{
+			const char* p = first;
+			std::string text{};
+			scan_errc ec = detail::parse_literal(p, last, '\'', text);
+			if (ec == scan_errc::ok && text.size() != 1)
+				ec = scan_errc::invalid;
+			if (ec != scan_errc::ok)
+				return {first, ec};
+			x.value = text[0];
+			return {p, ec};
+		}
+	};
+
+	template<typename E> // scan the name of an enumerator, the longest one matching
+	struct scan_trait<enumeration<E>>
+	{
+		static scan_result scan(const char* first, const char* last, enumeration<E> x) noexcept
+		{
+			const std::string_view s{first, static_cast<size_t>(last - first)};
+			const std::pair<E, std::string_view>* best = nullptr;
+			for (const auto& entry : enums::entries<E>)
+				if (s.substr(0, entry.second.size()) == entry.second
+					&& (best == nullptr || entry.second.size() > best->second.size()))
+					best = &entry;
+			if (best == nullptr)
+				return {first, scan_errc::invalid};
+			x.value = best->first;
+			return {first + best->second.size(), scan_errc::ok};
+		}
+	};
+
+	namespace detail
+	{
+		// scan one parameter: a value, or a text expected as-is
+		template<typename U>
+		inline scan_result scan_one(const char* first, const char* last, U&& x)
+		{
+			using T = std::decay_t<U>;
+			if constexpr (std::is_convertible_v<const T&, std::string_view> && !std::is_same_v<T, char>)
+			{
+				const std::string_view expected = x;
+				if (std::string_view{first, static_cast<size_t>(last - first)}.substr(0, expected.size()) != expected)
+					return {first, scan_errc::mismatch};
+				return {first + expected.size(), scan_errc::ok};
+			}
+			else
+				return scan_trait<T>::scan(first, last, x);
+		}
+	} // namespace detail
+
+	// scan_from: scan all the parameters in order from [first, last), stop at the first error
+	// texts are expected as-is, others are parsed by their scan_trait
+	template<typename... Us>
+	inline scan_result scan_from(const char* first, const char* last, Us&&... xs)
+	{
+		scan_result r{first, scan_errc::ok};
+		static_cast<void>(((r = detail::scan_one(r.ptr, last, std::forward<Us>(xs)), r.ec == scan_errc::ok) && ...));
+		return r;
+	}
+
+	// scan: scan all the parameters in order from `text`
+	// e.g. scan(s, "id=", hexadecimal(id), ", ok=", ok) inverts format("id=", hexadecimal(id), ", ok=", ok)
+	template<typename... Us>
+	inline scan_result scan(std::string_view text, Us&&... xs)
+	{
+		return scan_from(text.data(), text.data() + text.size(), std::forward<Us>(xs)...);
+	}
+} // namespace lava::scan
@@ -44,7 +44,7 @@ namespace lava::trace
 	template<typename T, typename F>
 	T&& debug_trace(const char* file, int line, const char* func, const char* expr, T&& val, F&& fmt)
 	{
-		std::string msg = format::legacy::format(
+		const auto msg = format::legacy::format_scoped(
 			'[', file, ':', format::legacy::decimal(line), " (", func, ")] ",
 			'(', get_type<T>(), ") ", expr, " = ", std::forward<F>(fmt),
 			format::legacy::endl);
@@ -55,7 +55,7 @@ namespace lava::trace
 	template<typename T, typename C, size_t N, typename = std::enable_if_t<format::legacy::is_char<C>>>
 	T&& debug_trace(const char* file, int line, const char* func, const char* expr, T&& val, const C (&fmt)[N])
 	{
-		std::string msg = format::legacy::format('[', file, ':', format::legacy::decimal(line), " (", func, ")] ", fmt, format::legacy::endl);
+		const auto msg = format::legacy::format_scoped('[', file, ':', format::legacy::decimal(line), " (", func, ")] ", fmt, format::legacy::endl);
 		trace_message(msg);
 		return std::forward<T>(val);
 	}
@@ -18,5 +18,12 @@ int main()
 	test_assert(invariant(1 == 2, "The invariant 1 == 2 should hold here."));
 	test_assert(unreachable("This code should not be reached."));
 	test_assert(panic("Don't panic. --The Hitchhiker's Guide to the Galaxy"));
+
+	// messages in another language, for all the threads which have not chosen one
+	lava::config::set_default_locale(lava::config::locale::english);
+	test_assert(expects(1 == 2, "The algorithm expects 1 == 2 here."));
+	// for this thread only
+	lava::config::set_locale(lava::config::locale::chinese_simplified);
+	test_assert(ensures(1 == 2, "The algorithm ensures 1 == 2 here."));
 	return 0;
 }
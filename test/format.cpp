@@ -1,28 +1,144 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
 #include <iostream>
-#include <lava/format/legacy.h>
+#include <limits>
+#include <lava/format.h>
+#include <lava/format/legacy/bytes.h>
+#include <lava/format/legacy/json.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// a row yielding its cells as temporaries, as a generator or a transforming view does
+struct stars_row
+{
+	std::vector<size_t> counts;
+	struct iterator
+	{
+		const size_t* p;
+		std::string operator*() const { return std::string(*p, '*'); }
+		iterator& operator++()
+		{
+			++p;
+			return *this;
+		}
+		bool operator!=(const iterator& rhs) const { return p != rhs.p; }
+	};
+	iterator begin() const { return {counts.data()}; }
+	iterator end() const { return {counts.data() + counts.size()}; }
+};
 
 int main()
 {
 	namespace fmt = lava::format::legacy;
+	// escape sequences are written even if stderr is not a terminal
+	fmt::set_colour_policy(fmt::colour_policy::always);
 	int arr[] = {42, 0, 1};
 	fmt::format_io(
 		std::cout,
 		"String:         ", "A String", fmt::endl,
 		"Character:      ", 'a', fmt::endl,
 		"Decimal:        ", fmt::decimal(42), fmt::endl,
+		"Negative:       ", fmt::decimal(-42), fmt::endl,
+		"Minimum:        ", fmt::decimal(std::numeric_limits<long long>::min()), fmt::endl,
 		"Octal:          ", fmt::octal(42), fmt::endl,
 		"Hexadecimal:    ", fmt::hexadecimal(42), fmt::endl,
+		"Lower-hex:      ", fmt::hexadecimal<false>(0xC0FFEEu), fmt::endl,
 		"Binary:         ", fmt::binary(42), fmt::endl,
+#ifdef __SIZEOF_INT128__
+		"128-bit:        ", fmt::hexadecimal(~fmt::detail::uint128_t{0}), fmt::endl,
+#endif
 		"23-Based:       ", fmt::number<23>(42), fmt::endl,
+		"Double:         ", 0.1, ' ', 1e100, ' ', -0.0, fmt::endl,
+		"Fixed:          ", fmt::fixed(3.14159, 2), fmt::endl,
+		"Scientific:     ", fmt::scientific(1234.5, 3), fmt::endl,
+		"Precision:      ", fmt::precision(2.0 / 3, 4), fmt::endl,
 		"Unicode:        ", fmt::unicode(U'a'), fmt::endl,
 		"Align-left:     ", fmt::left(10, "Text"), fmt::endl,
 		"Align-right:    ", fmt::right(10, "Text"), fmt::endl,
 		"Align-center:   ", fmt::center(10, "Text"), fmt::endl,
+		"Align-wide:     ", fmt::center(10, "中文"), '|', fmt::right(6, u"日本"), fmt::endl,
+		"UTF-16/UTF-32:  ", u"Unicode ", U"文本 ", U'\U0001F600', u'\u00E9', u'\xD800', fmt::endl,
 		"Pair:           ", std::pair(fmt::decimal(42), "Text"), fmt::endl,
 		"Tuple:          ", std::tuple('a', "String", fmt::unicode(U'x')), fmt::endl,
 		"Plain Array:    ", fmt::apply<fmt::num_base<int>>(arr), fmt::endl,
+		"Hex Array:      ", fmt::apply<fmt::hex_t<long long>>(std::vector<long long>{-1, 255, 1ll << 40}), fmt::endl,
 		"Literal-String: ", fmt::literal("String1\nString2"), fmt::endl,
+		"Literal-Long:   ", fmt::literal("A \"quoted\" line,\tlonger than 32 characters\\"), fmt::endl,
 		"Coloured text:  ", mkAnsi(fmt::Red_BRI + fmt::Intense, "Error"),
 		',', mkAnsi(fmt::Blue_BRI, "Infomation"), fmt::endl);
+	fmt::set_colour_policy(fmt::colour_policy::never);
+	fmt::format_io(std::cout, "Colour disabled: ", mkAnsi(fmt::ErrorColour, "Error"), fmt::endl);
+
+	// sinks other than strings and streams
+	char buffer[16];
+	const auto r = fmt::format_to_n(buffer, sizeof(buffer), "Truncated text longer than the buffer");
+	std::cout << std::flush;
+	fmt::format_file(stdout, "Fixed buffer:   ", std::string_view(buffer, r.out - buffer), " (", fmt::decimal(r.size), " in total)", fmt::endl);
+	std::fflush(stdout);
+#ifdef LAVA_FORMAT_HAS_FD_SINK
+	fmt::format_fd(1, "File descriptor:", ' ', fmt::hexadecimal(0xFDu), fmt::endl);
+#endif
+#ifdef LAVA_FORMAT_HAS_GATHER_SINK
+	// large texts are written from where they are, with a single writev
+	const std::string payload(fmt::gather_sink::borrow_threshold, '-');
+	fmt::format_gather(1, "Gathered:       ", fmt::decimal(payload.size()), ' ', payload, fmt::endl);
+#endif
+
+	// a batch of elements, formatted on several threads
+	const std::vector<std::string> lines(3, "Batch line\n");
+	std::cout << fmt::format_batch(lines, [](std::string& res, const std::string& x) { fmt::format_to(res, "Batch:          ", x); });
+
+	// scratch strings of this thread, reused with their capacity
+	std::cout << fmt::format_scoped("Scoped buffer:  ", fmt::decimal(42), fmt::endl).view();
+
+	// type-erased formatting, one core for all the argument types
+	std::cout << fmt::vformat_scoped("Type-erased:    ", fmt::decimal(42), ' ', std::string("text"), fmt::endl).view();
+
+	// constants formatted at compile time, coloured or not at runtime
+	static constexpr auto constant = fmt::format_constant<16>("Answer ", fmt::decimal(-42), ' ', fmt::hexadecimal(255));
+	static_assert(constant.view() == "Answer -42 FF");
+	std::cout << "Constant:       " << fmtConstant(constant.view(), ' ', fmt::Green, fmt::binary(5), fmt::Reset).view() << '\n';
+
+	// byte buffers, in hexadecimal, base64 and as a hex dump
+	const std::string bytes = "Lava\x01\xFF";
+	std::cout << fmt::format("Bytes:          ", fmt::hex(bytes), ' ', fmt::base64(bytes), fmt::endl);
+	std::cout << fmt::format("Bytes literal:  ", fmt::hex("abc"), ' ', fmt::base64("abc"), fmt::endl);
+	std::cout << fmt::format(fmt::hexdump(bytes, 0x10));
+
+	// tables, with columns as wide as their widest cell
+	const std::vector<std::vector<std::string>> cells{{"Table:", "left", "right"}, {"", "a", "1"}, {"", "long cell", "22"}};
+	std::cout << fmt::format(fmt::table(cells, "<<>"));
+	const std::vector<stars_row> stars{{{20, 1}}, {{2, 30}}};
+	std::cout << fmt::format(fmt::table(stars, ">"));
+
+	// JSON, mapped from the types of the values
+	const std::map<std::string, std::vector<int>> series{{"a\tb", {1, 2}}, {"c", {}}};
+	std::cout << fmt::format("JSON:           ", fmt::json_object(fmt::json_field("series", series), fmt::json_field("pi", 3.14),
+															   fmt::json_field("ok", true), fmt::json_field("none", nullptr)), fmt::endl);
+
+	// time points of system_clock in UTC, to their precision, and durations with their units
+	const auto epoch = std::chrono::system_clock::time_point{};
+	std::cout << fmt::format("Chrono:         ", std::chrono::time_point_cast<std::chrono::milliseconds>(epoch + std::chrono::hours{24 * 365} + std::chrono::milliseconds{1500}),
+							 ' ', std::chrono::milliseconds{15}, ' ', std::chrono::duration<double>{2.5}, fmt::endl);
+
+	// format strings, parsed at compile time
+	lava::format::format_io(
+		std::cout,
+		fmtString("Format string:  {} {:>8} {:x} {:08X} {:*^7}|{{}}\n"),
+		42, "Text", 255u, -42, 'c');
+	lava::format::format_io(
+		std::cout,
+		fmtString("Format float:   {} {:.3f} {:e} {:010.2f} {:G}\n"),
+		0.1f, 3.14159, 1234.5, -3.14159, 1e-20);
+	lava::format::format_io(
+		std::cout,
+		fmtString("Format padded:  [{:>12}] [{:-^18}]\n"),
+		std::pair(fmt::decimal(42), "Text"), std::tuple('a', fmt::unicode(U'x')));
+	// the field width of the stream applies to the whole text
+	std::cout << "Format width:   " << std::setw(8) << std::setfill('.');
+	lava::format::format_io(std::cout, fmtString("{}!"), 42);
+	std::cout << std::setfill(' ') << '\n';
 	return 0;
 }
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <lava/log.h>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace fmt = lava::format::legacy;
+
+int main()
+{
+	lava::log::logger log{std::cout};
+	const std::string user = "guest";
+	log.log("Deferred:       ", fmt::decimal(42), ' ', fmt::hexadecimal(255u), ' ', fmt::fixed(3.14159, 2), ' ', true, fmt::endl);
+	log.log("Copied text:    ", user, ' ', std::string_view{"view"}, fmt::endl);
+	const std::vector<int> values{1, 2, 3};
+	log.log("Formatted now:  ", fmt::apply<fmt::dec_t<int>>(values), fmt::endl);
+	std::thread other{[&log] { log.log("Other thread:   ", fmt::decimal(7), fmt::endl); }};
+	other.join();
+	log.flush();
+
+	// a ring too small for the messages: they overflow to a queue, in order
+	size_t lines = 0;
+	std::string last{};
+	{
+		lava::log::logger small{[&](const char* s, size_t n) {
+									for (size_t i = 0; i != n; ++i)
+										lines += s[i] == '\n';
+									last.assign(s, n);
+									return true;
+								},
+								4096, lava::log::overflow_policy::grow};
+		for (int i = 0; i != 10000; ++i)
+			small.log("Line ", fmt::decimal(i), fmt::endl);
+	}
+	std::cout << "Overflow:       " << lines << " lines, the last one " << last.substr(last.rfind('L'));
+
+	// a writer failing: the bytes lost are counted
+	lava::log::logger failing{[](const char*, size_t) { return false; }};
+	failing.log("Lost", fmt::endl);
+	failing.flush();
+	std::cout << "Write failure:  " << failing.failed() << ", " << failing.lost() << " bytes lost\n";
+
+	// colours to a file, which is no terminal: none written under the automatic policy, whatever stderr is
+	std::FILE* file = std::tmpfile();
+	{
+		lava::log::logger to_file{file};
+		to_file.log(fmt::Red, "Red", fmt::Reset, fmt::endl);
+	}
+	std::rewind(file);
+	char written[64]{};
+	const size_t n = std::fread(written, 1, sizeof(written) - 1, file);
+	std::fclose(file);
+	const bool escaped = std::string_view{written, n}.find("\033[") != std::string_view::npos;
+	std::cout << "Colour to file: " << std::string_view{written, n};
+	return escaped ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+#include <iostream>
+#include <lava/format.h>
+#include <lava/scan.h>
+#include <string>
+
+namespace fmt = lava::format::legacy;
+
+enum class level
+{
+	info,
+	warning,
+	error
+};
+
+int main()
+{
+	// scan the text produced by lava.format
+	const std::string text = fmt::format(
+		"[", fmt::decimal(-1234567890123456789ll), "] id=", fmt::hexadecimal(0xDEADBEEFu),
+		" mask=", fmt::binary(10), " ok=", true, " name=", fmt::literal<std::string>("a \"quoted\"\n"), " error");
+	long long time = 0;
+	unsigned id = 0;
+	int mask = 0;
+	bool ok = false;
+	std::string name{};
+	level lv{};
+	const auto r = lava::scan::scan(
+		text, "[", lava::scan::decimal(time), "] id=", lava::scan::hexadecimal(id),
+		" mask=", lava::scan::binary(mask), " ok=", ok, " name=", lava::scan::quoted(name), ' ', lava::scan::enum_name(lv));
+	fmt::format_io(
+		std::cout, "Scanned:        ", fmt::decimal(time), ' ', fmt::hexadecimal(id), ' ', fmt::decimal(mask), ' ', ok, ' ',
+		fmt::literal<std::string>(name), ' ', fmt::decimal(static_cast<int>(lv)), ' ', bool(r), fmt::endl);
+
+	// long hexadecimal identifiers, 8 digits at a time, of either case
+	uint64_t wide_id = 0;
+	const auto w = lava::scan::scan("0123456789aBcDeF", lava::scan::hexadecimal(wide_id));
+	fmt::format_io(std::cout, "Hexadecimal:    ", fmt::hexadecimal(wide_id), ' ', bool(w), fmt::endl);
+
+	// overflow is detected, the value is left untouched
+	unsigned char byte = 7;
+	const auto o = lava::scan::scan("256", lava::scan::decimal(byte));
+	fmt::format_io(std::cout, "Overflow:       ", o.ec == lava::scan::scan_errc::overflow, ' ', fmt::decimal(byte), fmt::endl);
+	const auto h = lava::scan::scan("10000000000000000", lava::scan::hexadecimal(wide_id));
+	fmt::format_io(std::cout, "Hex overflow:   ", h.ec == lava::scan::scan_errc::overflow, ' ', fmt::hexadecimal(wide_id), fmt::endl);
+	return 0;
+}